@@ -0,0 +1,125 @@
+/**
+ * @file  command_trace.h
+ *
+ * @brief DRAM command trace output. Commands are written either as text lines (dram.txt)
+ *        or as fixed-size binary records behind a small header. Both formats hold the
+ *        same information and command_record_to_text turns a record into its exact line.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __COMMAND_TRACE_H__
+#define __COMMAND_TRACE_H__
+
+#include "common.h"
+#include "trace_writer.h"
+
+#define COMMAND_TRACE_MAGIC "DRAMCMD"  // 7 characters + '\0'
+#define COMMAND_TRACE_VERSION 1
+#define COMMAND_LINE_LENGTH 64  // longest text line command_record_to_text can write
+#define MERGE_RECORDS_PER_READ 4096
+
+typedef enum CommandTraceFormat {
+  TEXT_FORMAT,
+  BINARY_FORMAT
+} CommandTraceFormat_t;
+
+typedef enum CommandCode {
+  CMD_NONE,
+  CMD_ACT0,
+  CMD_ACT1,
+  CMD_RD0,
+  CMD_RD1,
+  CMD_WR0,
+  CMD_WR1,
+  CMD_PRE,
+  CMD_REF,    // all-bank refresh
+  CMD_REFSB,  // same-bank refresh, bank is refreshed in every bank group
+  NUM_COMMAND_CODES
+} CommandCode_t;
+
+typedef struct __attribute__((__packed__)) CommandTraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;   // sizeof(CommandRecord_t)
+  uint64_t record_count;  // filled in when the trace is closed
+} CommandTraceHeader_t;
+
+typedef struct __attribute__((__packed__)) CommandRecord {
+  uint64_t cycle;
+  uint8_t channel;
+  uint8_t command;     // CommandCode_t
+  uint8_t bank_group;
+  uint8_t bank;
+  uint16_t address;    // row for ACT, column for RD/WR, unused for PRE and REF
+  uint16_t reserved;   // keeps records 16 bytes
+} CommandRecord_t;
+
+typedef struct CommandTrace {
+  TraceWriter_t *writer;
+  CommandTraceFormat_t format;
+  uint64_t record_count;
+} CommandTrace_t;
+
+extern const char *command_names[NUM_COMMAND_CODES];
+
+/**
+ * @brief Open a command trace. Binary traces start with a header.
+ *
+ * @param file_name  The output file name
+ * @param format     TEXT_FORMAT or BINARY_FORMAT
+ * @return CommandTrace_t*  The command trace
+ */
+CommandTrace_t *command_trace_open(char *file_name, CommandTraceFormat_t format);
+
+/**
+ * @brief Open a binary trace in an anonymous temporary file. Channels simulated on separate
+ *        threads each write to one, and command_trace_merge combines them at the end.
+ *
+ * @return CommandTrace_t*  The command trace
+ */
+CommandTrace_t *command_trace_open_temporary(void);
+
+/**
+ * @brief Flush the trace, record the number of commands in a binary header, and free memory.
+ *
+ * @param trace  The command trace
+ */
+void command_trace_close(CommandTrace_t *trace);
+
+/**
+ * @brief Drop every command written so far, leaving an empty trace (with its binary header).
+ *
+ * @param trace  The command trace
+ */
+void command_trace_truncate(CommandTrace_t *trace);
+
+/**
+ * @brief Append a command to the trace.
+ *
+ * @param trace   The command trace
+ * @param record  The command
+ */
+void command_trace_write(CommandTrace_t *trace, CommandRecord_t *record);
+
+/**
+ * @brief Append the commands of temporary traces to a trace in cycle order, then close the
+ *        temporary traces. Each input must be in cycle order; on a tie the earlier input goes first.
+ *
+ * @param trace        The command trace
+ * @param inputs       Traces opened with command_trace_open_temporary
+ * @param input_count  Number of inputs
+ */
+void command_trace_merge(CommandTrace_t *trace, CommandTrace_t **inputs, int input_count);
+
+/**
+ * @brief Format a command the way it appears in the text trace, including the newline.
+ *
+ * @param record  The command
+ * @param line    At least COMMAND_LINE_LENGTH characters
+ * @return size_t  Length of the line
+ */
+size_t command_record_to_text(CommandRecord_t *record, char *line);
+
+#endif
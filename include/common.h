@@ -2,6 +2,7 @@
 #define __COMMON_H__
 
 /*** includes ***/
+#include <ctype.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -25,7 +26,10 @@ enum SchedulingAlgorithms {
   LEVEL_0,
   LEVEL_1,
   LEVEL_2,
-  LEVEL_3
+  LEVEL_3,
+  LEVEL_4,
+  LEVEL_5,
+  NUM_SCHEDULING_ALGORITHMS
 };
 
 typedef enum Operation {
@@ -1,16 +1,6 @@
 /**
  * @file  dram.h
  *
- * @note the following timing constrains are actually one dimm cycle longer:
- *            tRC -> 115
- *            tRP -> 39
- *            tRRD_L -> 12, tRRD_S -> 8
- *            tRCD -> 39
- *            tCCD_L -> 12, tCCD_S -> 8
- *            tCCD_L_WTR -> 70, tCCD_S_WTR -> 52
- *            tCCD_L_WR -> 48, tCCD_S_WR -> 8
- *            tCCD_L_RTW -> 16, tCCD_S_RTW -> 16
- * 
  * @copyright Copyright (c) 2023
  *
  */
@@ -21,108 +11,178 @@
 #include "common.h"
 #include "memory_request.h"
 #include "queue.h"
+#include "command_trace.h"
+#include "latency.h"
+#include "timeline.h"
+#include "timing_profile.h"
 
 /*** macro(s), enum(s), struct(s) ***/
-#define TRC       114 // time interval between successive ACT commands to the same bank
-#define TRAS       76 // time interval between a bank ACT command and issuing the PRE command
-#define TRP        38 // time interval between a PRE command and a ACT command
-#define TRFC      708 // 295ns; time it takes to complete a refresh command
-#define TCWL       38 // aka tCWD; time interval between a WR command and the output of the first bit of data
-#define TCL        40 // aka tCAS; time interval between a RD command and the output of the first bit of data
-#define TRCD       38 // time interval between a ACT command and a RD/WR command
-#define TWR        30 // time interval between writing data and issuing a PRE command
-#define TRTP       18 // delay between internal RD command to PRE command within the same bank
-#define TBURST      8 // delay between the start and end of RD/WR data 
-#define NUM_TIMING_CONSTRAINTS 10 
-
-#define TRRD_L     11 // time interval between consecutive ACT commands to the same bank group
-#define TRRD_S      7 // time interval between consecutive ACT commands to different bank group
-#define TCCD_L     11 // time interval between consecutive RD commands between different banks in the same bank group
-#define TCCD_S      7 // time interval between consecutive RD commands between different banks in different bank group
-#define TCCD_L_WR  47 // time interval between consecutive WR commands between different banks in the same bank group
-#define TCCD_S_WR   7 // time interval between consecutive WR commands between different banks in different bank group
-#define TCCD_L_RTW 15 // READ -> WRITE in the same bank group
-#define TCCD_S_RTW 15 // READ -> WRITE in different bank group
-#define TCCD_L_WTR 69 // WRITE -> READ in the same bank group
-#define TCCD_S_WTR 51 // WRITE -> READ in different bank group
-#define NUM_CONSECUTIVE_CMD_CONSTRAINTS 10
-
-#define TFAW       32 // time window where there can be at most four ACT commands
 #define NUM_TFAW_COUNTERS 4
 
-#define NUM_BANKS 32
-#define NUM_BANK_GROUPS 8
-#define NUM_BANKS_PER_GROUP (NUM_BANKS / NUM_BANK_GROUPS)
+#define MAX_POSTPONED_REFRESHES 4 // REF commands that may be owed at once
+#define MAX_PULLED_IN_REFRESHES 4 // REF commands that may be issued ahead of time
+
+#define WRITE_HIGH_WATERMARK(size) (((size) * 3 + 3) / 4) // buffered writes that start a drain
+#define WRITE_LOW_WATERMARK(size) ((size) / 4)            // buffered writes left when a drain stops
+
+#define PAGE_PREDICTOR_MAX 3       // per-bank 2-bit saturating counter
+#define PAGE_PREDICTOR_KEEP_OPEN 2 // counter values from here up keep the row open after an access
+
 #define NUM_CHANNELS 2
 #define NUM_CHIPS_PER_CHANNEL 4
 
+#define CPU_CLOCK_GHZ (CPU_CLOCK_MHZ / 1000.0)
+#define PEAK_BANDWIDTH_GBPS (timing_profile.data_rate * 8 / 1000.0)  // two 32-bit channels; 38.4 for PC5-38400
+
 #define CACHE_LINE_BOUNDARY 64
 #define BANK_ALIGN 8
 
-extern uint16_t timing_attribute[NUM_TIMING_CONSTRAINTS];
-extern uint8_t consecutive_cmd_attribute[NUM_CONSECUTIVE_CMD_CONSTRAINTS];
-
-typedef enum TimingConstraints {
-  tRC,
-  tRAS,
-  tRP,
-  tRFC,
-  tCWL,
-  tCL,
-  tRCD,
-  tWR,
-  tRTP,
-  tBURST
-} TimingConstraints_t;
-
-typedef enum ConsecutiveCmdConstraints {
-  tRRD_L,
-  tRRD_S,
-  tCCD_L,
-  tCCD_S,
-  tCCD_L_WR,
-  tCCD_S_WR,
-  tCCD_L_RTW,
-  tCCD_S_RTW,
-  tCCD_L_WTR,
-  tCCD_S_WTR
-} ConsecutiveCmdConstraints_t;
-
-
-typedef struct __attribute__((__packed__)) Bank {
-  bool is_precharged;
-  bool is_active;
-  bool in_progress;
-  Operation_t last_request_operation;
-  uint32_t active_row;
-} Bank_t;
-
-typedef struct __attribute__((aligned(CACHE_LINE_BOUNDARY))) BankGroup {
-  Bank_t banks[NUM_BANKS_PER_GROUP];
-} BankGroup_t;
+typedef enum RefreshMode {
+  REFRESH_OFF,
+  REFRESH_ALL_BANK,   // REF: every bank, every tREFI
+  REFRESH_SAME_BANK   // REFsb: the same bank in every bank group, one bank per tREFI / NUM_BANKS_PER_GROUP
+} RefreshMode_t;
 
+// bank state is kept as one bit per bank in each mask, at bank_group * NUM_BANKS_PER_GROUP + bank
+// (see bank_bit), so a question about every bank is a few word operations.
+// timers are stored as the dram cycle at which the constraint is met (met when ready_at <= cycle)
 typedef struct DRAM {
-  BankGroup_t bank_groups[NUM_BANK_GROUPS];
-  uint16_t timing_constraints[NUM_BANK_GROUPS][NUM_BANKS_PER_GROUP][NUM_TIMING_CONSTRAINTS];
-  uint8_t tFAW_timers[NUM_TFAW_COUNTERS];
-  uint8_t consecutive_cmd_timers[NUM_CONSECUTIVE_CMD_CONSTRAINTS];
+  uint32_t open_banks;             // a row is open
+  uint32_t precharged_banks;       // no row is open
+  uint32_t in_progress_banks;      // a request's access is under way
+  uint32_t write_banks;            // the last request the bank was classified for was a write
+  uint32_t awaiting_access_banks;  // adaptive page policy: no request has followed the last access yet
+  uint32_t closed_early_banks;     // adaptive page policy: the row was closed right after the last access
+  uint32_t ready_banks[NUM_TIMING_CONSTRAINTS];  // banks whose constraint is met at cycle
+  uint32_t active_row[NUM_BANKS];
+  uint8_t page_predictor[NUM_BANKS];  // adaptive page policy: counts up on row hits, down on row misses
+  uint64_t timing_ready_at[NUM_TIMING_CONSTRAINTS][NUM_BANKS];
+  uint64_t tFAW_ready_at[NUM_TFAW_COUNTERS];
+  uint64_t consecutive_cmd_ready_at[NUM_CONSECUTIVE_CMD_CONSTRAINTS];
+  // FR-FCFS reorders commands, so its tRRD/tCCD go by the last ACT, RD and WR rather than the
+  // last command: the _L timings per bank group, the _S timings for the whole rank
+  bool is_checking_bank_groups;
+  uint64_t bank_group_ready_at[NUM_CONSECUTIVE_CMD_CONSTRAINTS][NUM_BANK_GROUPS];
+  uint64_t rank_ready_at[NUM_CONSECUTIVE_CMD_CONSTRAINTS];
+  uint64_t cycle;          // DIMM cycles this dram has been clocked for
+  uint64_t next_ready_at;  // earliest deadline not reached yet, UINT64_MAX if none
+  uint64_t refresh_due_at; // cycle the next refresh falls due, UINT64_MAX with refresh off
+  int16_t refresh_credit;  // refreshes issued ahead of time (> 0) or owed (< 0)
+  uint8_t refreshed_banks; // same-bank refresh: banks refreshed in the current round
+  uint32_t refresh_blocked;  // banks (bank_group * NUM_BANKS_PER_GROUP + bank) held closed for an overdue refresh
   uint8_t last_bank_group;
   Commands_t last_interface_cmd;
 } DRAM_t;
 
-typedef struct Channel {
+// outcome of keeping a row open or closing it early, decided by the access that comes next
+typedef struct PagePredictorStats {
+  uint64_t open_hits;     // row kept open and the next access hit it
+  uint64_t open_misses;   // row kept open but the next access needed another row
+  uint64_t close_hits;    // row closed early and the next access needed another row
+  uint64_t close_misses;  // row closed early but the next access wanted it again
+} PagePredictorStats_t;
+
+// command and data bus activity, for the bandwidth report
+typedef struct BandwidthStats {
+  uint64_t commands[NUM_COMMAND_CODES];  // issued commands by CommandCode_t
+  uint64_t data_bus_cycles;   // CPU clock cycles the data bus spent transferring bursts
+  uint64_t row_hits;          // requests that found their row open
+  uint64_t row_misses;        // requests that found another row open
+  uint64_t row_empties;       // requests that found the bank precharged
+  uint64_t bank_active_cycles;  // CPU clock cycles summed over banks, from ACT to PRE
+  uint64_t read_to_write;     // WR issued after a RD
+  uint64_t write_to_read;     // RD issued after a WR
+  uint64_t activated_at[NUM_BANKS];  // CPU clock cycle each open bank was activated at
+  uint32_t active_banks;      // banks (bank_group * NUM_BANKS_PER_GROUP + bank) activated and not precharged
+  CommandCode_t last_column_cmd;  // CMD_RD0, CMD_WR0 or CMD_NONE
+} BandwidthStats_t;
+
+// why a request waits; the tRRD/tCCD causes are in ConsecutiveCmdConstraints_t order
+typedef enum StallCause {
+  STALL_tRCD,
+  STALL_tRP,
+  STALL_tRC,
+  STALL_tRAS,
+  STALL_tRTP,
+  STALL_tWR,         // write data still in flight, or write recovery
+  STALL_tRFC,
+  STALL_tFAW,
+  STALL_tRRD_L,
+  STALL_tRRD_S,
+  STALL_tCCD_L,
+  STALL_tCCD_S,
+  STALL_tCCD_L_WR,
+  STALL_tCCD_S_WR,
+  STALL_tCCD_L_RTW,
+  STALL_tCCD_S_RTW,
+  STALL_tCCD_L_WTR,
+  STALL_tCCD_S_WTR,
+  STALL_REFRESH,     // the bank is held closed for an overdue refresh
+  STALL_BANK_BUSY,   // another request is using the bank
+  STALL_SCHEDULER,   // every timing is met, but the policy chose another command
+  STALL_QUEUE_FULL,  // the request arrived while its queue was full
+  NUM_STALL_CAUSES
+} StallCause_t;
+
+// CPU clock cycles requests spent waiting, by the bank they wait on and the cause
+typedef struct StallStats {
+  uint64_t cycles[NUM_BANKS][NUM_STALL_CAUSES];
+  MemoryRequest_t *issuing_request;  // issued a command in the current DIMM cycle, so it did not wait
+  bool is_closed_page;               // level 0 checks fewer constraints
+} StallStats_t;
+
+extern const char *stall_cause_names[NUM_STALL_CAUSES];
+
+// the requests in a channel's queues, counted by bank and by how far their access has got.
+// kept up to date as requests change state, so the refresh scheduler and the write queue
+// never have to walk the queues to find them
+typedef struct BankRequests {
+  uint32_t in_flight[NUM_BANKS];       // access under way: past ACT0/PRE and not COMPLETE
+  uint32_t activating[NUM_BANKS];      // between ACT0 and ACT1
+  uint32_t complete[NUM_BANKS];        // COMPLETE and not removed from the queue yet
+  uint32_t blocked_writes[NUM_BANKS];  // buffered writes waiting for an older read of the same line
+  uint32_t in_flight_banks;            // banks with a non-zero count, one mask per count
+  uint32_t activating_banks;
+  uint32_t complete_banks;
+  uint32_t blocked_write_banks;
+} BankRequests_t;
+
+// channels are simulated on separate threads, so everything a channel writes lives here
+typedef struct __attribute__((aligned(CACHE_LINE_BOUNDARY))) Channel {
   DRAM_t DDR5_chip[NUM_CHIPS_PER_CHANNEL];
+  CommandTrace_t *commands;  // merged into the DIMM's output file when the DIMM is destroyed
+  bool is_idle;              // true if the last DIMM cycle changed no request and expired no timer
+  bool is_draining_writes;   // separate write queue: writes are being scheduled instead of reads
+  PagePredictorStats_t page_predictor;
+  LatencyStats_t latency;    // requests that left this channel's queues
+  BandwidthStats_t bandwidth;
+  Timeline_t *timeline;      // bank states, NULL unless a timeline file was given
+  StallStats_t *stalls;      // NULL unless stalls are attributed
+  Queue_t *queue;            // the queues of the DIMM cycle being run, for requests changing state
+  Queue_t *write_queue;      // NULL without a separate write queue
+  BankRequests_t requests;
 } Channel_t;
 
 typedef struct DIMM {
   Channel_t channels[NUM_CHANNELS];
-  FILE *output_file;
+  CommandTrace_t *output_file;
+  RefreshMode_t refresh_mode;
+  char *timeline_file;  // NULL without a timeline
 } DIMM_t;
 
+// one DIMM cycle of a scheduling policy, compiled for that policy (see scheduler_kernel)
+typedef void (*SchedulerKernel_t)(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t clock);
+
 /*** function declaration(s) ***/
-void dimm_create(DIMM_t **dimm, char *output_file_name);
+void dimm_create(DIMM_t **dimm, char *output_file_name, CommandTraceFormat_t output_format, RefreshMode_t refresh_mode, char *timeline_file_name, bool is_attributing_stalls);
 void dimm_destroy(DIMM_t **dimm);
-void process_request(DIMM_t **dimm, Queue_t **q, uint64_t dimm_cycle, uint8_t scheduling_algorithm);
+void issue_cmd(Channel_t *channel, CommandCode_t cmd, MemoryRequest_t *request, uint64_t cycle);
+void process_request(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t dimm_cycle, uint8_t scheduling_algorithm);
+SchedulerKernel_t scheduler_kernel(uint8_t scheduling_algorithm, bool has_write_queue);
+uint64_t skip_idle_cycles(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t max_cycles);
+void finish_bandwidth_stats(Channel_t *channel, uint64_t clock);
+void record_queue_full(Channel_t *channel, MemoryRequest_t *request, uint64_t cycles);
+void buffer_write(Channel_t *channel, Queue_t *q, Queue_t *write_q, MemoryRequest_t *write);
 void check_requests_age(Queue_t *global_queue);
 void increment_aging_in_queue(Queue_t *global_queue);
 
@@ -0,0 +1,73 @@
+/**
+ * @file  latency.h
+ *
+ * @brief Per-request latency statistics. Latencies are counted in log-scale buckets, so the
+ *        memory used does not grow with the number of requests and percentiles stay within
+ *        1/LATENCY_SUB_BUCKETS of the true value.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include "common.h"
+#include "memory_request.h"
+
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)  // buckets per power of two
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+#define NUM_OPERATIONS 3
+#define NUM_CORES 12
+
+typedef struct LatencyHistogram {
+  uint64_t buckets[LATENCY_BUCKETS];
+  uint64_t count;
+  uint64_t total;           // sum of the latencies, for the mean
+  uint64_t queued_total;    // sum of arrival to first command
+  uint64_t max;
+} LatencyHistogram_t;
+
+// latencies are CPU clock cycles from a request's arrival to the end of its data burst
+typedef struct LatencyStats {
+  LatencyHistogram_t operations[NUM_OPERATIONS];  // indexed by Operation_t
+  LatencyHistogram_t cores[NUM_CORES];
+  uint64_t retire_total;  // sum of data complete to dequeue
+} LatencyStats_t;
+
+/**
+ * @brief Record a request that leaves the queue.
+ *
+ * @param stats  The statistics
+ * @param request  The request; its first command and data complete cycles must be set
+ * @param dequeue_cycle  The CPU clock cycle the request leaves the queue
+ */
+void latency_record(LatencyStats_t *stats, MemoryRequest_t *request, uint64_t dequeue_cycle);
+
+/**
+ * @brief Add the statistics in from to into.
+ *
+ * @param into  The statistics to add to
+ * @param from  The statistics to add
+ */
+void latency_merge(LatencyStats_t *into, LatencyStats_t *from);
+
+/**
+ * @brief Get a percentile of a histogram, as the upper bound of the bucket it falls in.
+ *
+ * @param histogram  The histogram
+ * @param percentile  The percentile (0-100)
+ * @return uint64_t  The latency, at most the largest one recorded
+ */
+uint64_t latency_percentile(LatencyHistogram_t *histogram, double percentile);
+
+/**
+ * @brief Print a table with the count, mean and percentiles of every operation and core.
+ *
+ * @param file  Where to print
+ * @param stats  The statistics
+ */
+void latency_print(FILE *file, LatencyStats_t *stats);
+
+#endif
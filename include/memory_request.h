@@ -10,6 +10,24 @@
 
 #include "common.h"
 
+#define CACHE_LINE_SIZE 64  // bytes moved by one RD/WR burst
+#define CYCLE_UNSET UINT64_MAX  // a request cycle that has not happened yet
+
+// a request addresses one of NUM_BANK_GROUPS (3 bits) x NUM_BANKS_PER_GROUP (2 bits) banks
+#define NUM_BANKS 32
+#define NUM_BANK_GROUPS 8
+#define NUM_BANKS_PER_GROUP (NUM_BANKS / NUM_BANK_GROUPS)
+_Static_assert(NUM_BANKS <= 32, "bank masks are 32 bits wide");
+#define ALL_BANKS ((uint32_t)((1ULL << NUM_BANKS) - 1))
+
+// how an address is split into channel, bank group, bank, row and column
+typedef enum AddressMapping {
+  MAPPING_DEFAULT,     // row[33:18] col_high[17:12] BA[11:10] BG[9:7] CH[6] col_low[5:2]
+  MAPPING_XOR,         // MAPPING_DEFAULT with BG ^= row[2:0] and BA ^= row[4:3]
+  MAPPING_ROW,         // row[33:18] BA[17:16] BG[15:13] CH[12] col_high[11:6] col_low[5:2]
+  MAPPING_CACHE_LINE,  // row[33:18] col_high[17:12] CH[11] BA[10:9] BG[8:6] col_low[5:2]
+  NUM_ADDRESS_MAPPINGS
+} AddressMapping_t;
 
 typedef enum MemoryRequestState {
   PENDING,
@@ -22,7 +40,8 @@ typedef enum MemoryRequestState {
   BUFFER,
   BURST,
   PRE,
-  COMPLETE
+  COMPLETE,
+  NUM_REQUEST_STATES
 } MemoryRequestState_t;
 
 
@@ -38,12 +57,35 @@ typedef struct __attribute__((__packed__)) MemoryRequest {
   uint16_t column_high : 6;  // 6 bits (column[9:4])
   uint16_t row : 16;         // 16 bits
   MemoryRequestState_t state;
-  uint32_t aging;
+  uint64_t enqueue_cycle;  // queue cycle at which the request entered the queue
+  uint64_t first_command_cycle;  // CPU clock cycle of the first command issued for the request
+  uint64_t data_complete_cycle;  // CPU clock cycle the request's data burst ended
+  uint32_t older_reads;  // buffered write: queued reads of the same line that have not read their data yet
   bool is_finished;
 } MemoryRequest_t;
 
+/**
+ * @brief Select the address mapping used by every later memory_request_init and get_address.
+ *        The mapping is shared by the whole process, so it is set once before simulating.
+ *
+ * @param mapping  The address mapping
+ */
+void set_address_mapping(AddressMapping_t mapping);
+
+/**
+ * @brief Look up an address mapping by its name: default, xor, row or line.
+ *
+ * @param name  The name
+ * @param mapping  Set to the mapping if the name is known
+ * @return true if the name is known
+ */
+bool address_mapping_from_name(const char *name, AddressMapping_t *mapping);
+const char *address_mapping_name(AddressMapping_t mapping);
+
 void memory_request_init(MemoryRequest_t *memoryRequest, uint64_t time, uint8_t core, uint8_t operation, uint64_t address);
 void log_memory_request(char *prefix, MemoryRequest_t *memory_request, uint64_t cycle);
 uint16_t get_column(MemoryRequest_t *memory_request);
+uint64_t get_address(MemoryRequest_t *memory_request);
+bool is_same_cache_line(MemoryRequest_t *memory_request, MemoryRequest_t *other);
 
 #endif
\ No newline at end of file
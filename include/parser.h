@@ -8,10 +8,30 @@
 #ifndef __PARSER_H__
 #define __PARSER_H__
 
+#include <pthread.h>
 #include "common.h"
 #include "memory_request.h"
 
-#define LINE_LENGTH 256
+#define TRACE_MAGIC "DRAMTRC"  // 7 characters + '\0'
+#define TRACE_VERSION 1
+#define FEED_BLOCK_SIZE 1024  // requests handed to a channel at once
+#define FEED_NUM_BLOCKS 16    // blocks buffered per channel; the feed waits once they are all filled
+
+typedef struct __attribute__((__packed__)) TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;   // sizeof(TraceRecord_t)
+  uint64_t record_count;
+} TraceHeader_t;
+
+// binary traces keep the raw address so the address mapping is still applied at run time
+typedef struct __attribute__((__packed__)) TraceRecord {
+  uint64_t time;
+  uint64_t address;
+  uint8_t core;
+  uint8_t operation;
+  uint8_t reserved[6];  // keeps records 24 bytes
+} TraceRecord_t;
 
 typedef enum ParserStatus {
   OK,
@@ -19,9 +39,50 @@ typedef enum ParserStatus {
   END_OF_FILE,
 } ParserStatus_t;
 
+typedef struct FeedBlock {
+  MemoryRequest_t requests[FEED_BLOCK_SIZE];
+  size_t count;
+} FeedBlock_t;
+
+// one channel's share of the trace: a ring of blocks filled by the feed's thread and emptied by the channel's parser
+typedef struct ChannelFeed {
+  FeedBlock_t blocks[FEED_NUM_BLOCKS];
+  uint32_t first;         // oldest filled block
+  uint32_t filled;        // blocks filled and not given back yet
+  bool is_done;           // the trace has been read, no more blocks are filled
+  FeedBlock_t *filling;   // block the feed's thread is filling, NULL if none; not shared
+  pthread_mutex_t lock;   // guards first, filled and is_done
+  pthread_cond_t changed;
+} ChannelFeed_t;
+
+/**
+ * Parses a trace once, on a thread of its own, and splits its requests by channel, so every
+ * channel gets its requests without parsing the whole trace again. A channel that falls behind
+ * holds the feed up once its blocks are all filled, which keeps the memory used fixed.
+ */
+typedef struct TraceFeed {
+  struct Parser *parser;
+  pthread_t thread;
+  ChannelFeed_t *channels;
+  int num_channels;
+} TraceFeed_t;
+
+/**
+ * The input file is memory-mapped and tokenized in place, so no line is copied and no
+ * request is allocated. Two request slots are used: the one last returned by
+ * parser_next_request and the one parsed ahead of it (next_request).
+ * Files starting with TRACE_MAGIC are read as binary traces of TraceRecord_t.
+ * A parser made by parser_init_feed reads one channel's requests from a TraceFeed_t instead.
+ */
 typedef struct Parser {
-  FILE *file;
-  char line[LINE_LENGTH];
+  char *data;                    // mapped input file
+  size_t size;                   // size of the input file in bytes
+  size_t position;               // offset of the first unparsed character
+  bool is_binary;                // binary trace instead of text
+  ChannelFeed_t *feed;           // requests come from here instead of the file, NULL if the file is parsed
+  FeedBlock_t *block;            // feed block being read, NULL if none
+  size_t block_position;         // next request in block
+  MemoryRequest_t requests[2];
   MemoryRequest_t *next_request;
   ParserStatus_t status;
 } Parser_t;
@@ -34,6 +95,33 @@ typedef struct Parser {
  */
 Parser_t *parser_init(char *input_file);
 
+/**
+ * @brief Initialize a parser that returns one channel's requests from a feed.
+ *        Waits until the channel's first request has been parsed.
+ *
+ * @param feed     The feed
+ * @param channel  The channel whose requests are returned
+ * @return Parser_t*  The parser
+ */
+Parser_t *parser_init_feed(TraceFeed_t *feed, int channel);
+
+/**
+ * @brief Start parsing a trace on a new thread, for num_channels channels.
+ *
+ * @param input_file    The input file name
+ * @param num_channels  Number of channels the requests are split into
+ * @return TraceFeed_t*  The feed
+ */
+TraceFeed_t *trace_feed_create(char *input_file, int num_channels);
+
+/**
+ * @brief Wait for the feed's thread and free the feed. Every channel's parser must have
+ *        read its requests up to the end of the trace.
+ *
+ * @param feed  The feed
+ */
+void trace_feed_destroy(TraceFeed_t *feed);
+
 /**
  * @brief Destroy parser and free memory.
  *
@@ -43,6 +131,7 @@ void parser_destroy(Parser_t *parser);
 
 /**
  * @brief Get the next request from the parser if the current cycle is greater than the request's time.
+ *        The request stays valid until the next call.
  *
  * @param parser  The parser
  * @param cycle  The current cpu cycle
@@ -50,4 +139,13 @@ void parser_destroy(Parser_t *parser);
  */
 MemoryRequest_t *parser_next_request(Parser_t *parser, uint64_t cycle);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Parse one trace line ("<time> <core> <operation> <address>"). Exits on invalid input.
+ *
+ * @param line  Start of the line
+ * @param end  One past the last character of the line (including its newline, if any)
+ * @param memory_request  Where to store the request
+ */
+void parse_line(const char *line, const char *end, MemoryRequest_t *memory_request);
+
+#endif
@@ -16,27 +16,102 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "doubly_linked_list.h"
 #include "memory_request.h"
 
 /*** marco(s), enum(s), struct(s) ***/
+#define QUEUE_ALIGNMENT 64          // slots start on a cache line
+#define QUEUE_MAX_CAPACITY UINT16_MAX // slots are addressed by 2-byte indices
+#define QUEUE_NO_SLOT UINT16_MAX      // end of a slot list; never a valid slot since capacity is below it
+#define QUEUE_KEY_GAP ((uint64_t)1 << 16) // spacing of order keys, leaves room to insert between neighbours
+
+enum queue_err_code {
+    QUEUE_EXIT_SUCCESS  = 0,
+    QUEUE_EXIT_USER_ERR = 1
+};
+
+// one bank's requests, by state and by whether they have started their access; all lists are in queue order
+typedef struct QueueBank {
+    uint16_t state_head[NUM_REQUEST_STATES];  // first request in each state, the PENDING list holds the pending requests
+    uint16_t state_tail[NUM_REQUEST_STATES];
+    uint16_t started_head;  // first request past PENDING (including COMPLETE ones not removed yet)
+    uint16_t started_tail;
+    uint16_t lead_head;     // first pending request that leads (see Queue_t)
+    uint16_t lead_tail;
+    uint32_t count;         // requests in the queue
+    uint32_t open_row;          // row set by queue_set_open_row
+    uint32_t open_row_pending;  // pending requests to open_row
+} QueueBank_t;
+
+/**
+ * Requests live in a fixed pool of slots that never move while queued. The queue order is
+ * kept separately as a doubly linked list of slot indices, so adding or removing a request
+ * anywhere in the queue only relinks 2-byte indices and a queued request can be removed by
+ * its pointer in O(1). There is no access by position: the queue is walked from either end
+ * with queue_peek/queue_next/queue_prev, and requests are inserted next to a request.
+ *
+ * Every request is also linked into two lists of its bank: the list of its state, and the
+ * list of started requests once it is past PENDING, so a scheduler can look at one bank, or at
+ * one bank's requests in one state, without walking the queue. A request is filed by the state
+ * it is queued in and refiled by queue_update_state when its state changes. Order keys increase
+ * along the queue, so two requests are compared in O(1) (queue_is_ahead).
+ *
+ * A pending request leads unless the request just ahead of it in the queue is a pending request
+ * to the same bank. Only the leading ones of a run of such requests can be the next to move, so
+ * each bank also keeps a list of its leading requests.
+ */
 typedef struct Queue {
-    DoublyLinkedList_t *list;
+    MemoryRequest_t *slots; // request storage, allocated once
+    uint16_t *next;         // next[slot] is the slot behind it in the queue, QUEUE_NO_SLOT at the back
+    uint16_t *prev;         // prev[slot] is the slot ahead of it in the queue, QUEUE_NO_SLOT at the front
+    uint16_t *free_slots;   // stack of unused slot indices
+    uint16_t *bank_next;    // bank_next[slot] is the slot behind it in its bank's started list, QUEUE_NO_SLOT at the back
+    uint16_t *bank_prev;    // bank_prev[slot] is the slot ahead of it in its bank's started list, QUEUE_NO_SLOT at the front
+    uint16_t *state_next;   // state_next[slot] is the slot behind it in its bank's list of its state
+    uint16_t *state_prev;   // state_prev[slot] is the slot ahead of it in its bank's list of its state
+    uint64_t *order_key;    // order_key[slot] grows along the queue
+    uint8_t *filed_state;   // filed_state[slot]: the state list the slot is in
+    uint16_t *lead_next;    // lead_next[slot] is the slot behind it in its bank's leader list
+    uint16_t *lead_prev;    // lead_prev[slot] is the slot ahead of it in its bank's leader list
+    uint8_t *is_leading;    // is_leading[slot]: the slot is in its bank's leader list
+    QueueBank_t banks[NUM_BANKS];
+    uint32_t state_banks[NUM_REQUEST_STATES]; // banks with a request in each state
+    uint32_t started_banks; // banks with a started request
+    uint16_t head;          // slot at the front of the queue
+    uint16_t tail;          // slot at the back of the queue
+    uint64_t free_count;    // number of unused slots
     uint64_t size;
     uint64_t max_size; // maximum size of the queue
+    uint64_t cycle;    // DIMM cycles the queue has been serviced for; a request's age is measured against it
 } Queue_t;
 
 /*** function declaration(s) ***/
-int8_t queue_create(Queue_t **q, uint8_t max_size);
+int8_t queue_create(Queue_t **q, uint64_t max_size);
 void queue_destroy(Queue_t **q);
-int8_t queue_insert_at(Queue_t **q, uint8_t index, MemoryRequest_t value);
+int8_t queue_insert_before(Queue_t **q, MemoryRequest_t *position, MemoryRequest_t value);
+int8_t queue_insert_after(Queue_t **q, MemoryRequest_t *position, MemoryRequest_t value);
 int8_t enqueue(Queue_t **q, MemoryRequest_t value);
-MemoryRequest_t queue_delete_at(Queue_t **q, uint8_t index);
+MemoryRequest_t queue_remove(Queue_t **q, MemoryRequest_t *request);
 MemoryRequest_t dequeue(Queue_t **q);
 MemoryRequest_t *queue_peek(Queue_t *q);
-MemoryRequest_t *queue_peek_at(Queue_t *q, uint8_t index);
+MemoryRequest_t *queue_next(Queue_t *q, MemoryRequest_t *request);
+MemoryRequest_t *queue_prev(Queue_t *q, MemoryRequest_t *request);
+MemoryRequest_t *queue_bank_pending(Queue_t *q, int bank);
+MemoryRequest_t *queue_bank_started(Queue_t *q, int bank);
+MemoryRequest_t *queue_bank_next(Queue_t *q, MemoryRequest_t *request);
+MemoryRequest_t *queue_bank_state(Queue_t *q, int bank, MemoryRequestState_t state);
+MemoryRequest_t *queue_state_next(Queue_t *q, MemoryRequest_t *request);
+MemoryRequest_t *queue_bank_leader(Queue_t *q, int bank);
+MemoryRequest_t *queue_leader_next(Queue_t *q, MemoryRequest_t *request);
+uint32_t queue_state_banks(Queue_t *q, MemoryRequestState_t state);
+uint32_t queue_bank_count(Queue_t *q, int bank);
+uint32_t queue_queued_banks(Queue_t *q);
+void queue_update_state(Queue_t *q, MemoryRequest_t *request);
+void queue_set_open_row(Queue_t *q, int bank, uint32_t row);
+uint32_t queue_open_row_pending(Queue_t *q, int bank);
+bool queue_is_ahead(Queue_t *q, MemoryRequest_t *request, MemoryRequest_t *other);
+uint64_t queue_order_key(Queue_t *q, MemoryRequest_t *request);
+bool queue_holds(Queue_t *q, MemoryRequest_t *request);
 bool queue_is_full(Queue_t *q);
 bool queue_is_empty(Queue_t *q);
 void print_queue(Queue_t *q);
-void queue_swap(Queue_t **q, uint8_t i1, uint8_t i2);
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,50 @@
+/**
+ * @file  simulation.h
+ *
+ * @brief Runs one trace through the memory controller. Every simulation owns its parser,
+ *        queue and DIMM, so independent simulations can run on separate threads.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include "common.h"
+#include "command_trace.h"
+#include "dimm.h"
+
+typedef struct SimulationConfig {
+  char *input_file;
+  char *output_file;
+  int scheduling_policy;
+  uint64_t queue_size;
+  bool fast_forward;  // skip DIMM cycles where every request is waiting on a timer
+  CommandTraceFormat_t output_format;
+  RefreshMode_t refresh_mode;
+  uint64_t write_queue_size;  // 0 keeps writes in the same queue as reads
+  char *timeline_file;        // bank state timeline (.json or CSV), NULL for none
+  bool attribute_stalls;      // find out why requests wait, every DIMM cycle
+} SimulationConfig_t;
+
+typedef struct SimulationResult {
+  uint64_t total_cycles;  // CPU clock cycles
+  uint64_t request_count;
+  uint64_t forwarded_reads;  // reads served from the write queue
+  uint64_t merged_writes;    // writes merged into a buffered write to the same line
+  PagePredictorStats_t page_predictor;
+  LatencyStats_t latency;
+  BandwidthStats_t bandwidth;
+  uint64_t stall_cycles[NUM_CHANNELS][NUM_BANKS][NUM_STALL_CAUSES];  // only with attribute_stalls
+} SimulationResult_t;
+
+/**
+ * @brief Simulate the trace in config->input_file and write the DRAM commands to config->output_file.
+ *
+ * @param config  The simulation parameters
+ * @param result  Where to store the results
+ */
+void simulate(SimulationConfig_t *config, SimulationResult_t *result);
+
+#endif
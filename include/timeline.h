@@ -0,0 +1,101 @@
+/**
+ * @file  timeline.h
+ *
+ * @brief Bank state timeline. Every command a channel issues moves a bank to a new state, and
+ *        each state a bank leaves is written as an interval of CPU clock cycles, either as a
+ *        Chrome trace-event JSON file (chrome://tracing, Perfetto) or as CSV.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __TIMELINE_H__
+#define __TIMELINE_H__
+
+#include "common.h"
+#include "command_trace.h"
+#include "trace_writer.h"
+
+typedef enum TimelineFormat {
+  TIMELINE_CSV,
+  TIMELINE_JSON
+} TimelineFormat_t;
+
+typedef enum BankActivity {
+  BANK_IDLE,         // precharged; never written
+  BANK_ACTIVATING,   // ACT until tRCD
+  BANK_OPEN,         // row open, no access under way
+  BANK_READING,      // RD until the end of its data
+  BANK_WRITING,      // WR until the end of its data
+  BANK_PRECHARGING,  // PRE until tRP
+  BANK_REFRESHING,   // REF/REFsb until tRFC/tRFCsb
+  NUM_BANK_ACTIVITIES
+} BankActivity_t;
+
+typedef struct BankTimeline {
+  uint64_t start;       // CPU clock cycle the current activity began at
+  uint64_t busy_until;  // CPU clock cycle a timed activity ends at
+  uint16_t row;         // open row, kept from the last ACT
+  uint8_t activity;     // BankActivity_t
+} BankTimeline_t;
+
+// one per channel; the intervals go to a temporary file until the channels are merged
+typedef struct Timeline {
+  TraceWriter_t *writer;
+  TimelineFormat_t format;
+  uint8_t channel;
+  int banks_per_group;
+  int bank_count;
+  BankTimeline_t *banks;
+} Timeline_t;
+
+/**
+ * @brief Get the format a timeline file is written in: JSON if its name ends in ".json",
+ *        CSV otherwise.
+ *
+ * @param file_name  The timeline file name
+ * @return TimelineFormat_t  The format
+ */
+TimelineFormat_t timeline_format_of(char *file_name);
+
+/**
+ * @brief Open the timeline of a channel. Every bank starts idle.
+ *
+ * @param format  TIMELINE_CSV or TIMELINE_JSON
+ * @param channel  The channel
+ * @param bank_groups  Number of bank groups
+ * @param banks_per_group  Number of banks in a bank group
+ * @return Timeline_t*  The timeline
+ */
+Timeline_t *timeline_open(TimelineFormat_t format, uint8_t channel, int bank_groups, int banks_per_group);
+
+/**
+ * @brief Move the banks a command targets to their next state.
+ *
+ * @param timeline  The channel's timeline
+ * @param cmd  The command issued
+ * @param bank_group  The bank group (unused for REF)
+ * @param bank  The bank (for REFsb, the bank refreshed in every bank group)
+ * @param row  The row opened by an ACT
+ * @param cycle  The CPU clock cycle the command was issued at
+ */
+void timeline_record(Timeline_t *timeline, CommandCode_t cmd, uint8_t bank_group, uint8_t bank, uint16_t row, uint64_t cycle);
+
+/**
+ * @brief Write the state every bank is in at the end of the simulation.
+ *
+ * @param timeline  The channel's timeline
+ * @param cycle  The CPU clock cycle the channel finished at
+ */
+void timeline_finish(Timeline_t *timeline, uint64_t cycle);
+
+/**
+ * @brief Write the timelines of all channels to a file and close them.
+ *
+ * @param file_name  The timeline file name
+ * @param timelines  The channels' timelines, all in the same format
+ * @param count  Number of timelines
+ */
+void timeline_merge(char *file_name, Timeline_t **timelines, int count);
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file  timing_profile.h
+ *
+ * @brief DDR5 timing profile. The simulator starts with the built-in DDR5-4800 x8 profile below
+ *        and can replace it with a profile file, so a different speed bin or CAS latency does not
+ *        need a rebuild. Timings are in DIMM clock cycles. The bank geometry (8 bank groups of 4
+ *        banks, 1KB pages) is fixed, so a profile for x4 or x16 devices only changes the timings.
+ *
+ * @note the following timing constrains are actually one dimm cycle longer:
+ *            tRC -> 115
+ *            tRP -> 39
+ *            tRRD_L -> 12, tRRD_S -> 8
+ *            tRCD -> 39
+ *            tCCD_L -> 12, tCCD_S -> 8
+ *            tCCD_L_WTR -> 70, tCCD_S_WTR -> 52
+ *            tCCD_L_WR -> 48, tCCD_S_WR -> 8
+ *            tCCD_L_RTW -> 16, tCCD_S_RTW -> 16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __TIMING_PROFILE_H__
+#define __TIMING_PROFILE_H__
+
+#include "common.h"
+
+/*** built-in DDR5-4800 x8 profile ***/
+#define DATA_RATE 4800    // MT/s; the DIMM clock runs at half of it
+#define TRC       114 // time interval between successive ACT commands to the same bank
+#define TRAS       76 // time interval between a bank ACT command and issuing the PRE command
+#define TRP        38 // time interval between a PRE command and a ACT command
+#define TRFC      708 // 295ns; time it takes to complete a refresh command
+#define TCWL       38 // aka tCWD; time interval between a WR command and the output of the first bit of data
+#define TCL        40 // aka tCAS; time interval between a RD command and the output of the first bit of data
+#define TRCD       38 // time interval between a ACT command and a RD/WR command
+#define TWR        30 // time interval between writing data and issuing a PRE command
+#define TRTP       18 // delay between internal RD command to PRE command within the same bank
+#define TBURST      8 // delay between the start and end of RD/WR data 
+#define NUM_TIMING_CONSTRAINTS 10 
+
+#define TRRD_L     11 // time interval between consecutive ACT commands to the same bank group
+#define TRRD_S      7 // time interval between consecutive ACT commands to different bank group
+#define TCCD_L     11 // time interval between consecutive RD commands between different banks in the same bank group
+#define TCCD_S      7 // time interval between consecutive RD commands between different banks in different bank group
+#define TCCD_L_WR  47 // time interval between consecutive WR commands between different banks in the same bank group
+#define TCCD_S_WR   7 // time interval between consecutive WR commands between different banks in different bank group
+#define TCCD_L_RTW 15 // READ -> WRITE in the same bank group
+#define TCCD_S_RTW 15 // READ -> WRITE in different bank group
+#define TCCD_L_WTR 69 // WRITE -> READ in the same bank group
+#define TCCD_S_WTR 51 // WRITE -> READ in different bank group
+#define NUM_CONSECUTIVE_CMD_CONSTRAINTS 10
+
+#define TFAW       32 // time window where there can be at most four ACT commands
+#define TREFI    9360 // 3.9us; average interval between REF commands
+#define TRFCSB    312 // 130ns; time it takes to complete a same-bank refresh
+
+#define TIMING_PROFILE_NAME_MAX 64
+
+// the CPU clock is fixed at 4.8 GHz; a DIMM clock of data_rate / 2 MHz makes the DIMM cycle a
+// fraction of 2 * CPU_CLOCK_MHZ / data_rate CPU cycles (exactly 2 for DDR5-4800)
+#define CPU_CLOCK_MHZ 4800
+
+typedef enum TimingConstraints {
+  tRC,
+  tRAS,
+  tRP,
+  tRFC,
+  tCWL,
+  tCL,
+  tRCD,
+  tWR,
+  tRTP,
+  tBURST
+} TimingConstraints_t;
+
+typedef enum ConsecutiveCmdConstraints {
+  tRRD_L,
+  tRRD_S,
+  tCCD_L,
+  tCCD_S,
+  tCCD_L_WR,
+  tCCD_S_WR,
+  tCCD_L_RTW,
+  tCCD_S_RTW,
+  tCCD_L_WTR,
+  tCCD_S_WTR
+} ConsecutiveCmdConstraints_t;
+
+typedef struct TimingProfile {
+  char name[TIMING_PROFILE_NAME_MAX];
+  uint32_t data_rate;     // MT/s
+  uint32_t timing_attribute[NUM_TIMING_CONSTRAINTS];
+  uint32_t consecutive_cmd_attribute[NUM_CONSECUTIVE_CMD_CONSTRAINTS];
+  uint32_t tFAW;
+  uint32_t tREFI;
+  uint32_t tRFCsb;
+} TimingProfile_t;
+
+// the profile every DIMM is simulated with; only changed before a simulation starts
+extern TimingProfile_t timing_profile;
+
+/**
+ * @brief Replace the timing profile with one read from a file. The file has one
+ *        "key = value" per line and "#" comments:
+ *          name = DDR5-5600B
+ *          data_rate = 5600
+ *          tCL = 46
+ *          tRCD = 16ns
+ *        Timings are in DIMM clock cycles, or in nanoseconds with an "ns" suffix, which are
+ *        rounded up to cycles at the profile's data rate. Keys left out keep their built-in
+ *        value. Errors are reported with the line they are on and end the program.
+ *
+ * @param file_name  The profile file
+ */
+void timing_profile_load(char *file_name);
+
+// the DIMM cycle a CPU cycle falls in
+static inline uint64_t dimm_cycle_at(uint64_t cpu_cycle) {
+  return cpu_cycle * timing_profile.data_rate / (2 * CPU_CLOCK_MHZ);
+}
+
+// the CPU cycle a DIMM cycle starts on
+static inline uint64_t cpu_cycle_of(uint64_t dimm_cycle) {
+  return (dimm_cycle * 2 * CPU_CLOCK_MHZ + timing_profile.data_rate - 1) / timing_profile.data_rate;
+}
+
+// true if a DIMM cycle starts on the CPU cycle
+static inline bool is_dimm_clock_edge(uint64_t cpu_cycle) {
+  return cpu_cycle * timing_profile.data_rate % (2 * CPU_CLOCK_MHZ) < timing_profile.data_rate;
+}
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file  trace_writer.h
+ *
+ * @brief Buffered writer for the simulator's output files. Records are formatted straight
+ *        into a large reusable buffer that is written to the file in big blocks.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef __TRACE_WRITER_H__
+#define __TRACE_WRITER_H__
+
+#include "common.h"
+
+#define TRACE_WRITER_BUFFER_SIZE (1 << 20) // 1 MiB
+#define TRACE_WRITER_STDOUT "-"              // file name that writes to standard output
+
+typedef struct TraceWriter {
+  FILE *file;
+  char *buffer;
+  size_t used;  // bytes in the buffer not yet written to the file
+} TraceWriter_t;
+
+/**
+ * @brief Open the output file and allocate the buffer.
+ *
+ * @param file_name  The output file name, or TRACE_WRITER_STDOUT
+ * @return TraceWriter_t*  The writer
+ */
+TraceWriter_t *trace_writer_open(char *file_name);
+
+/**
+ * @brief Open an anonymous temporary file that is deleted once closed. The file is opened for
+ *        reading and writing, so it can be read back after trace_writer_flush.
+ *
+ * @return TraceWriter_t*  The writer
+ */
+TraceWriter_t *trace_writer_open_temporary(void);
+
+/**
+ * @brief Flush any buffered output, close the file and free memory.
+ *
+ * @param writer  The writer
+ */
+void trace_writer_close(TraceWriter_t *writer);
+
+/**
+ * @brief Write the buffered output to the file.
+ *
+ * @param writer  The writer
+ */
+void trace_writer_flush(TraceWriter_t *writer);
+
+/**
+ * @brief Drop the buffered output and everything written to the file so far, and write from
+ *        the start of the file again.
+ *
+ * @param writer  The writer
+ */
+void trace_writer_truncate(TraceWriter_t *writer);
+
+/**
+ * @brief Get space for a record of at most length bytes, flushing first if the buffer is full.
+ *        The record is added to the output once it is committed.
+ *
+ * @param writer  The writer
+ * @param length  Upper bound on the record length (at most TRACE_WRITER_BUFFER_SIZE)
+ * @return char*  Where to format the record
+ */
+char *trace_writer_reserve(TraceWriter_t *writer, size_t length);
+
+/**
+ * @brief Add the record formatted in the reserved space to the output.
+ *
+ * @param writer  The writer
+ * @param length  The actual record length
+ */
+void trace_writer_commit(TraceWriter_t *writer, size_t length);
+
+/**
+ * @brief Copy a record into the output.
+ *
+ * @param writer  The writer
+ * @param data    The record
+ * @param length  The record length in bytes
+ */
+void trace_writer_write(TraceWriter_t *writer, const void *data, size_t length);
+
+/**
+ * @brief Format an unsigned decimal right-aligned in a field of width characters, like "%*llu".
+ *
+ * @return size_t  Number of characters written
+ */
+size_t format_decimal(char *buffer, uint64_t value, int width);
+
+/**
+ * @brief Format an unsigned value as zero-padded upper case hex, like "%0*llX".
+ *
+ * @return size_t  Number of characters written
+ */
+size_t format_hex(char *buffer, uint64_t value, int digits);
+
+#endif
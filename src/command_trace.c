@@ -0,0 +1,199 @@
+/**
+ * @file  command_trace.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stddef.h>
+#include "command_trace.h"
+
+const char *command_names[NUM_COMMAND_CODES] = {
+  "",
+  "ACT0",
+  "ACT1",
+  "RD0",
+  "RD1",
+  "WR0",
+  "WR1",
+  "PRE",
+  "REF",
+  "REFsb"
+};
+
+static void write_header(CommandTrace_t *trace) {
+  if (trace->format == BINARY_FORMAT) {
+    CommandTraceHeader_t header = {0};
+    memcpy(header.magic, COMMAND_TRACE_MAGIC, sizeof(COMMAND_TRACE_MAGIC));
+    header.version = COMMAND_TRACE_VERSION;
+    header.record_size = sizeof(CommandRecord_t);
+    trace_writer_write(trace->writer, &header, sizeof(header));
+  }
+}
+
+static CommandTrace_t *command_trace_create(TraceWriter_t *writer, CommandTraceFormat_t format) {
+  CommandTrace_t *trace = malloc(sizeof(CommandTrace_t));
+
+  if (trace == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  trace->writer = writer;
+  trace->format = format;
+  trace->record_count = 0;
+  write_header(trace);
+
+  return trace;
+}
+
+CommandTrace_t *command_trace_open(char *file_name, CommandTraceFormat_t format) {
+  return command_trace_create(trace_writer_open(file_name), format);
+}
+
+CommandTrace_t *command_trace_open_temporary(void) {
+  return command_trace_create(trace_writer_open_temporary(), BINARY_FORMAT);
+}
+
+void command_trace_close(CommandTrace_t *trace) {
+  if (trace == NULL) {
+    return;
+  }
+
+  // the record count is only known now, patch it into the header
+  if (trace->format == BINARY_FORMAT) {
+    trace_writer_flush(trace->writer);
+
+    if (
+      fseek(trace->writer->file, offsetof(CommandTraceHeader_t, record_count), SEEK_SET) != 0 ||
+      fwrite(&trace->record_count, sizeof(trace->record_count), 1, trace->writer->file) != 1
+    ) {
+      fprintf(stderr, "%s:%d: writing the command trace header failed\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  trace_writer_close(trace->writer);
+  free(trace);
+}
+
+void command_trace_truncate(CommandTrace_t *trace) {
+  trace_writer_truncate(trace->writer);
+  trace->record_count = 0;
+  write_header(trace);
+}
+
+void command_trace_write(CommandTrace_t *trace, CommandRecord_t *record) {
+  if (trace->format == BINARY_FORMAT) {
+    trace_writer_write(trace->writer, record, sizeof(CommandRecord_t));
+  }
+  else {
+    char *line = trace_writer_reserve(trace->writer, COMMAND_LINE_LENGTH);
+    trace_writer_commit(trace->writer, command_record_to_text(record, line));
+  }
+
+  trace->record_count++;
+}
+
+static size_t read_records(CommandTrace_t *input, CommandRecord_t *records) {
+  size_t records_read = fread(records, sizeof(CommandRecord_t), MERGE_RECORDS_PER_READ, input->writer->file);
+
+  if (ferror(input->writer->file)) {
+    fprintf(stderr, "%s:%d: reading a temporary command trace failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  return records_read;
+}
+
+void command_trace_merge(CommandTrace_t *trace, CommandTrace_t **inputs, int input_count) {
+  CommandRecord_t *records = malloc(input_count * MERGE_RECORDS_PER_READ * sizeof(CommandRecord_t));
+  size_t *next = calloc(input_count, sizeof(size_t));
+  size_t *count = calloc(input_count, sizeof(size_t));
+
+  if (records == NULL || next == NULL || count == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  // read every input back from the first record
+  for (int i = 0; i < input_count; i++) {
+    trace_writer_flush(inputs[i]->writer);
+    if (fseek(inputs[i]->writer->file, sizeof(CommandTraceHeader_t), SEEK_SET) != 0) {
+      fprintf(stderr, "%s:%d: rewinding a temporary command trace failed\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+    }
+    count[i] = read_records(inputs[i], &records[i * MERGE_RECORDS_PER_READ]);
+  }
+
+  while (true) {
+    // the input with the earliest next command; ties go to the lower input
+    int earliest = -1;
+    for (int i = 0; i < input_count; i++) {
+      if (next[i] < count[i] && (
+        earliest == -1 ||
+        records[i * MERGE_RECORDS_PER_READ + next[i]].cycle < records[earliest * MERGE_RECORDS_PER_READ + next[earliest]].cycle
+      )) {
+        earliest = i;
+      }
+    }
+
+    if (earliest == -1) {
+      break;
+    }
+
+    command_trace_write(trace, &records[earliest * MERGE_RECORDS_PER_READ + next[earliest]]);
+
+    if (++next[earliest] == count[earliest]) {
+      count[earliest] = read_records(inputs[earliest], &records[earliest * MERGE_RECORDS_PER_READ]);
+      next[earliest] = 0;
+    }
+  }
+
+  for (int i = 0; i < input_count; i++) {
+    command_trace_close(inputs[i]);
+  }
+
+  free(records);
+  free(next);
+  free(count);
+}
+
+size_t command_record_to_text(CommandRecord_t *record, char *line) {
+  // same layout as "%10llu %u %4s %u %u 0x%04X"; PRE has no row/column field
+  size_t length = format_decimal(line, record->cycle, 10);
+
+  line[length++] = ' ';
+  length += format_decimal(line + length, record->channel, 0);
+  line[length++] = ' ';
+
+  // command is right-aligned in a 4 character field
+  const char *cmd = (record->command < NUM_COMMAND_CODES) ? command_names[record->command] : "?";
+  size_t cmd_length = strlen(cmd);
+  for (size_t i = cmd_length; i < 4; i++) {
+    line[length++] = ' ';
+  }
+  memcpy(line + length, cmd, cmd_length);
+  length += cmd_length;
+
+  // an all-bank refresh has no bank, a same-bank refresh only the bank
+  if (record->command == CMD_REF) {
+    line[length++] = '\n';
+    return length;
+  }
+  if (record->command != CMD_REFSB) {
+    line[length++] = ' ';
+    length += format_decimal(line + length, record->bank_group, 0);
+  }
+  line[length++] = ' ';
+  length += format_decimal(line + length, record->bank, 0);
+
+  if (record->command != CMD_PRE && record->command != CMD_REFSB) {
+    memcpy(line + length, " 0x", 3);
+    length += 3;
+    length += format_hex(line + length, record->address, 4);
+  }
+
+  line[length++] = '\n';
+  return length;
+}
@@ -7,50 +7,36 @@
 
 #include "dimm.h"
 
-uint16_t timing_attribute[NUM_TIMING_CONSTRAINTS] = {
-  TRC,
-  TRAS,
-  TRP,
-  TRFC,
-  TCWL,
-  TCL,
-  TRCD,
-  TWR,
-  TRTP,
-  TBURST
-};
+/*** helper function(s) ***/
+int bank_index(uint8_t bank_group, uint8_t bank) {
+  return bank_group * NUM_BANKS_PER_GROUP + bank;
+}
 
-uint8_t consecutive_cmd_attribute[NUM_CONSECUTIVE_CMD_CONSTRAINTS] = {
-  TRRD_L,
-  TRRD_S,
-  TCCD_L,
-  TCCD_S,
-  TCCD_L_WR,
-  TCCD_S_WR,
-  TCCD_L_RTW,
-  TCCD_S_RTW,
-  TCCD_L_WTR,
-  TCCD_S_WTR
-};
+uint32_t bank_bit(uint8_t bank_group, uint8_t bank) {
+  return (uint32_t)1 << bank_index(bank_group, bank);
+}
+
+uint32_t request_bank_bit(MemoryRequest_t *request) {
+  return bank_bit(request->bank_group, request->bank);
+}
 
-/*** helper function(s) ***/
 bool is_bank_active(DRAM_t *dram, MemoryRequest_t *request) {
-  bool active_result = dram->bank_groups[request->bank_group].banks[request->bank].is_active;
+  bool active_result = (dram->open_banks & request_bank_bit(request)) != 0;
   return active_result;
 }
 
 bool is_bank_precharged(DRAM_t *dram, MemoryRequest_t *request) {
-  bool precharged_result = dram->bank_groups[request->bank_group].banks[request->bank].is_precharged;
+  bool precharged_result = (dram->precharged_banks & request_bank_bit(request)) != 0;
   return precharged_result;
 }
 
 bool is_page_hit(DRAM_t *dram, MemoryRequest_t *request) {
-  bool result = is_bank_active(dram, request) && dram->bank_groups[request->bank_group].banks[request->bank].active_row == request->row;
+  bool result = is_bank_active(dram, request) && dram->active_row[bank_index(request->bank_group, request->bank)] == request->row;
   return result;
 }
 
 bool is_page_miss(DRAM_t *dram, MemoryRequest_t *request) {
-  bool result = is_bank_active(dram, request) && dram->bank_groups[request->bank_group].banks[request->bank].active_row != request->row;
+  bool result = is_bank_active(dram, request) && dram->active_row[bank_index(request->bank_group, request->bank)] != request->row;
   return result;
 }
 
@@ -59,126 +45,291 @@ bool is_page_empty(DRAM_t *dram, MemoryRequest_t *request) {
   return result;
 }
 
-void activate_bank(DRAM_t *dram, MemoryRequest_t *request) {
-  dram->bank_groups[request->bank_group].banks[request->bank].is_active = true;
-  dram->bank_groups[request->bank_group].banks[request->bank].active_row = request->row;
+void activate_bank(Channel_t *channel, DRAM_t *dram, MemoryRequest_t *request) {
+  int bank = bank_index(request->bank_group, request->bank);
+  dram->open_banks |= request_bank_bit(request);
+  dram->precharged_banks &= ~request_bank_bit(request);
+  dram->active_row[bank] = request->row;
+
+  // the queues count their pending requests to the open row, for FR-FCFS to find row hits
+  queue_set_open_row(channel->queue, bank, request->row);
+  if (channel->write_queue != NULL) {
+    queue_set_open_row(channel->write_queue, bank, request->row);
+  }
 }
 
 void precharge_bank(DRAM_t *dram, MemoryRequest_t *request) {
-  dram->bank_groups[request->bank_group].banks[request->bank].is_precharged = true;
-  dram->bank_groups[request->bank_group].banks[request->bank].is_active = false;
+  dram->precharged_banks |= request_bank_bit(request);
+  dram->open_banks &= ~request_bank_bit(request);
+}
+
+void set_bank_operation(DRAM_t *dram, MemoryRequest_t *request) {
+  // the operation the bank's next PRE has to wait for
+  if (request->operation == DATA_WRITE) {
+    dram->write_banks |= request_bank_bit(request);
+  }
+  else {
+    dram->write_banks &= ~request_bank_bit(request);
+  }
+}
+
+void set_in_progress(DRAM_t *dram, MemoryRequest_t *request, bool in_progress) {
+  if (in_progress) {
+    dram->in_progress_banks |= request_bank_bit(request);
+  }
+  else {
+    dram->in_progress_banks &= ~request_bank_bit(request);
+  }
+}
+
+void count_cmd(Channel_t *channel, CommandCode_t cmd, uint8_t bank_group, uint8_t bank, uint64_t cycle) {
+  BandwidthStats_t *stats = &channel->bandwidth;
+  int index = bank_index(bank_group, bank);
+  uint32_t bank_mask = bank_bit(bank_group, bank);
+
+  stats->commands[cmd]++;
+
+  switch (cmd) {
+    case CMD_ACT0:
+      if (stats->active_banks & bank_mask) {
+        stats->bank_active_cycles += cycle - stats->activated_at[index];
+      }
+      stats->activated_at[index] = cycle;
+      stats->active_banks |= bank_mask;
+      break;
+
+    case CMD_PRE:
+      if (stats->active_banks & bank_mask) {
+        stats->bank_active_cycles += cycle - stats->activated_at[index];
+        stats->active_banks &= ~bank_mask;
+      }
+      break;
+
+    case CMD_RD0:
+    case CMD_WR0:
+      stats->data_bus_cycles += cpu_cycle_of(dimm_cycle_at(cycle) + timing_profile.timing_attribute[tBURST]) - cycle;
+      if (stats->last_column_cmd != CMD_NONE && stats->last_column_cmd != cmd) {
+        if (cmd == CMD_WR0) {
+          stats->read_to_write++;
+        }
+        else {
+          stats->write_to_read++;
+        }
+      }
+      stats->last_column_cmd = cmd;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void finish_bandwidth_stats(Channel_t *channel, uint64_t clock) {
+  // rows still open at the end count as active until the last cycle
+  BandwidthStats_t *stats = &channel->bandwidth;
+
+  for (int i = 0; i < NUM_BANKS; i++) {
+    if (stats->active_banks & ((uint32_t)1 << i)) {
+      stats->bank_active_cycles += clock - stats->activated_at[i];
+    }
+  }
+  stats->active_banks = 0;
 }
 
-char *issue_cmd(char *cmd, MemoryRequest_t *request, uint64_t cycle) {
+void issue_cmd(Channel_t *channel, CommandCode_t cmd, MemoryRequest_t *request, uint64_t cycle) {
   /**
-   * @brief Constructs a command string to be written to the output file.
+   * @brief Writes a command to the channel's command trace.
    *
-   * @param cmd     command string (ACT, PRE, RD, or WR)
+   * @param cmd     command code (ACT0/1, PRE, RD0/1, or WR0/1)
    * @param request memory request
-   * @return char*  command string to be written to the output file
    */
-  char *response = malloc(sizeof(char) * 100);
-  char *temp = malloc(sizeof(char) * 100);
-
-  sprintf(response, "%10" PRIu64 " %u %4s", cycle, request->channel, cmd);
-
-  if (strncmp(cmd, "ACT", 3) == 0) {
-    sprintf(temp, " %u %u 0x%04X", request->bank_group, request->bank, request->row);
-
-  } else if (strncmp(cmd, "PRE", 3) == 0) {
-    sprintf(temp, " %u %u", request->bank_group, request->bank);
+  CommandRecord_t record = {
+    .cycle = cycle,
+    .channel = request->channel,
+    .command = cmd,
+    .bank_group = request->bank_group,
+    .bank = request->bank,
+    .address = 0
+  };
+
+  if (cmd == CMD_ACT0 || cmd == CMD_ACT1) {
+    record.address = request->row;
+  }
+  else if (cmd != CMD_PRE) {
+    record.address = get_column(request);
+  }
 
-  } else if (strncmp(cmd, "RD", 2) == 0 || strncmp(cmd, "WR", 2) == 0) {
-    sprintf(temp, " %u %u 0x%04X", request->bank_group, request->bank, get_column(request));
+  command_trace_write(channel->commands, &record);
+  count_cmd(channel, cmd, request->bank_group, request->bank, cycle);
+  if (channel->stalls != NULL) {
+    channel->stalls->issuing_request = request;
+  }
+  if (channel->timeline != NULL) {
+    timeline_record(channel->timeline, cmd, request->bank_group, request->bank, request->row, cycle);
   }
 
-  strcat(response, temp);
-  free(temp);
+  if (request->first_command_cycle == CYCLE_UNSET) {
+    request->first_command_cycle = cycle;
+  }
+}
 
-  return response;
+void schedule_expiry(DRAM_t *dram, uint64_t ready_at) {
+  if (ready_at < dram->next_ready_at) {
+    dram->next_ready_at = ready_at;
+  }
 }
 
 void set_tfaw_timer(DRAM_t *dram) {
   for (int i = 0; i < NUM_TFAW_COUNTERS; i++) {
-    if (dram->tFAW_timers[i] == 0) {
-      dram->tFAW_timers[i] = TFAW;
+    if (dram->tFAW_ready_at[i] <= dram->cycle) {
+      dram->tFAW_ready_at[i] = dram->cycle + timing_profile.tFAW;
+      schedule_expiry(dram, dram->tFAW_ready_at[i]);
       break;  // only want to set one counter at a time
     }
   }
 }
 
+void set_bank_timer(DRAM_t *dram, int bank, TimingConstraints_t constraint_type, uint64_t ready_at) {
+  // every timing is at least one cycle, so the constraint stops being met until ready_at
+  dram->timing_ready_at[constraint_type][bank] = ready_at;
+  dram->ready_banks[constraint_type] &= ~((uint32_t)1 << bank);
+  schedule_expiry(dram, ready_at);
+}
+
 void set_timing_constraint(DRAM_t *dram, MemoryRequest_t *request, TimingConstraints_t constraint_type) {
-  dram->timing_constraints[request->bank_group][request->bank][constraint_type] = timing_attribute[constraint_type];
+  uint64_t ready_at = dram->cycle + timing_profile.timing_attribute[constraint_type];
+  set_bank_timer(dram, bank_index(request->bank_group, request->bank), constraint_type, ready_at);
 }
 
 void set_consecutive_cmd_timers(DRAM_t *dram, ConsecutiveCmdConstraints_t constraint_type) {
-  dram->consecutive_cmd_timers[constraint_type] = consecutive_cmd_attribute[constraint_type];
+  dram->consecutive_cmd_ready_at[constraint_type] = dram->cycle + timing_profile.consecutive_cmd_attribute[constraint_type];
+  schedule_expiry(dram, dram->consecutive_cmd_ready_at[constraint_type]);
 }
 
 void set_trrd_timers(DRAM_t *dram) {
-  dram->consecutive_cmd_timers[tRRD_L] = consecutive_cmd_attribute[tRRD_L];
-  dram->consecutive_cmd_timers[tRRD_S] = consecutive_cmd_attribute[tRRD_S];
+  set_consecutive_cmd_timers(dram, tRRD_L);
+  set_consecutive_cmd_timers(dram, tRRD_S);
 }
 
 void set_tccd_timers(DRAM_t *dram) {
-  dram->consecutive_cmd_timers[tCCD_L]     = consecutive_cmd_attribute[tCCD_L];
-  dram->consecutive_cmd_timers[tCCD_S]     = consecutive_cmd_attribute[tCCD_S];
-  dram->consecutive_cmd_timers[tCCD_L_WR]  = consecutive_cmd_attribute[tCCD_L_WR];
-  dram->consecutive_cmd_timers[tCCD_S_WR]  = consecutive_cmd_attribute[tCCD_S_WR];
-  dram->consecutive_cmd_timers[tCCD_L_RTW] = consecutive_cmd_attribute[tCCD_L_RTW];
-  dram->consecutive_cmd_timers[tCCD_S_RTW] = consecutive_cmd_attribute[tCCD_S_RTW];
-  dram->consecutive_cmd_timers[tCCD_L_WTR] = consecutive_cmd_attribute[tCCD_L_WTR];
-  dram->consecutive_cmd_timers[tCCD_S_WTR] = consecutive_cmd_attribute[tCCD_S_WTR];
+  set_consecutive_cmd_timers(dram, tCCD_L);
+  set_consecutive_cmd_timers(dram, tCCD_S);
+  set_consecutive_cmd_timers(dram, tCCD_L_WR);
+  set_consecutive_cmd_timers(dram, tCCD_S_WR);
+  set_consecutive_cmd_timers(dram, tCCD_L_RTW);
+  set_consecutive_cmd_timers(dram, tCCD_S_RTW);
+  set_consecutive_cmd_timers(dram, tCCD_L_WTR);
+  set_consecutive_cmd_timers(dram, tCCD_S_WTR);
+}
+
+void set_bank_group_timers(DRAM_t *dram, uint8_t bank_group, ConsecutiveCmdConstraints_t same_group) {
+  // same_group is an _L timing, its _S timing for the other bank groups comes right after it
+  dram->bank_group_ready_at[same_group][bank_group] = dram->cycle + timing_profile.consecutive_cmd_attribute[same_group];
+  dram->rank_ready_at[same_group + 1] = dram->cycle + timing_profile.consecutive_cmd_attribute[same_group + 1];
+  schedule_expiry(dram, dram->bank_group_ready_at[same_group][bank_group]);
+  schedule_expiry(dram, dram->rank_ready_at[same_group + 1]);
 }
 
-void decrement_tfaw_timers(DRAM_t *dram) {
+uint64_t expire_timers(DRAM_t *dram) {
+  /**
+   * @brief Marks the bank timers that have expired as met and finds the earliest deadline that
+   *        has not been reached yet. Only called when a deadline expires, not on every DIMM
+   *        cycle, and only the bank timers still running are looked at.
+   *
+   * @return uint64_t  earliest pending deadline, or UINT64_MAX if no timer is running
+   */
+  uint64_t next_ready_at = UINT64_MAX;
+
+  for (int i = 0; i < NUM_TIMING_CONSTRAINTS; i++) {
+    uint32_t running = ~dram->ready_banks[i] & ALL_BANKS;
+    while (running != 0) {
+      int bank = __builtin_ctz(running);
+      uint64_t ready_at = dram->timing_ready_at[i][bank];
+      running &= running - 1;
+
+      if (ready_at <= dram->cycle) {
+        dram->ready_banks[i] |= (uint32_t)1 << bank;
+      }
+      else if (ready_at < next_ready_at) {
+        next_ready_at = ready_at;
+      }
+    }
+  }
+
+  for (int i = 0; i < NUM_CONSECUTIVE_CMD_CONSTRAINTS; i++) {
+    uint64_t ready_at = dram->consecutive_cmd_ready_at[i];
+    if (ready_at > dram->cycle && ready_at < next_ready_at) {
+      next_ready_at = ready_at;
+    }
+  }
+
   for (int i = 0; i < NUM_TFAW_COUNTERS; i++) {
-    if (dram->tFAW_timers[i] != 0) {
-      dram->tFAW_timers[i]--;
+    uint64_t ready_at = dram->tFAW_ready_at[i];
+    if (ready_at > dram->cycle && ready_at < next_ready_at) {
+      next_ready_at = ready_at;
     }
   }
-}
 
-void decrement_timing_constraints(DRAM_t *dram) {
-  // TODO: need a table to keep track of active timers. 3 nested loop is too big of a hit on performance
-  // works for now
-  for (int i = 0; i < NUM_BANK_GROUPS; i++) {
-    for (int j = 0; j < NUM_BANKS_PER_GROUP; j++) {
-      for (int k = 0; k < NUM_TIMING_CONSTRAINTS; k++) {
-        if (dram->timing_constraints[i][j][k] != 0) {
-          dram->timing_constraints[i][j][k]--;
+  if (dram->is_checking_bank_groups) {
+    for (int i = 0; i < NUM_CONSECUTIVE_CMD_CONSTRAINTS; i++) {
+      for (int j = 0; j < NUM_BANK_GROUPS; j++) {
+        uint64_t ready_at = dram->bank_group_ready_at[i][j];
+        if (ready_at > dram->cycle && ready_at < next_ready_at) {
+          next_ready_at = ready_at;
         }
       }
+      if (dram->rank_ready_at[i] > dram->cycle && dram->rank_ready_at[i] < next_ready_at) {
+        next_ready_at = dram->rank_ready_at[i];
+      }
     }
   }
+
+  if (dram->refresh_due_at > dram->cycle && dram->refresh_due_at < next_ready_at) {
+    next_ready_at = dram->refresh_due_at;
+  }
+
+  return next_ready_at;
 }
 
-void decrement_consecutive_cmd_timers(DRAM_t *dram) {
-  for (int i = 0; i < NUM_CONSECUTIVE_CMD_CONSTRAINTS; i++) {
-    if (dram->consecutive_cmd_timers[i] != 0) {
-      dram->consecutive_cmd_timers[i]--;
-    }
+void advance_dram_clock(Channel_t *channel, DRAM_t *dram, uint64_t cycles) {
+  /**
+   * @brief Moves the dram's timing clock forward. Timers are deadlines on this clock, so
+   *        nothing is decremented. A deadline being reached can unblock a request, so the
+   *        cycle is no longer considered idle.
+   */
+  dram->cycle += cycles;
+
+  if (dram->cycle >= dram->next_ready_at) {
+    dram->next_ready_at = expire_timers(dram);
+    channel->is_idle = false;
   }
 }
 
 bool is_timing_constraint_met(DRAM_t *dram, MemoryRequest_t *request, TimingConstraints_t constraint_type) {
-  bool result = dram->timing_constraints[request->bank_group][request->bank][constraint_type] == 0;
+  bool result = (dram->ready_banks[constraint_type] & request_bank_bit(request)) != 0;
   return result;
 }
 
 bool is_trrd_met(DRAM_t *dram, ConsecutiveCmdConstraints_t constraint_type) {
-  return dram->consecutive_cmd_timers[constraint_type] == 0;
+  return dram->consecutive_cmd_ready_at[constraint_type] <= dram->cycle;
 }
 
 bool is_tccds_met(DRAM_t *dram, ConsecutiveCmdConstraints_t constraint_type) {
-  return dram->consecutive_cmd_timers[constraint_type] == 0;
+  return dram->consecutive_cmd_ready_at[constraint_type] <= dram->cycle;
+}
+
+bool is_bank_group_timer_met(DRAM_t *dram, uint8_t bank_group, ConsecutiveCmdConstraints_t same_group) {
+  // met when both the _L timing of the bank group and the _S timing of the rank are.
+  // without FR-FCFS the last command is all that is checked (see is_trrd_met)
+  return !dram->is_checking_bank_groups ||
+         (dram->bank_group_ready_at[same_group][bank_group] <= dram->cycle && dram->rank_ready_at[same_group + 1] <= dram->cycle);
 }
 
 bool can_issue_act(DRAM_t *dram) {
-  // if any counter is set to 0 then we can issue an ACT cmd
+  // if any counter has expired then we can issue an ACT cmd
   // without violating the tFAW timing constraint
   for (int i = 0; i < NUM_TFAW_COUNTERS; i++) {
-    if (dram->tFAW_timers[i] == 0) {
+    if (dram->tFAW_ready_at[i] <= dram->cycle) {
       return true;
     }
   }
@@ -186,55 +337,254 @@ bool can_issue_act(DRAM_t *dram) {
   return false;
 }
 
+uint32_t act_ready_banks(DRAM_t *dram) {
+  // banks an ACT can go to now as far as the bank timers, tFAW and refresh are concerned.
+  // tRRD depends on the last command rather than the bank, so it is left to the state machine
+  if (!can_issue_act(dram)) {
+    return 0;
+  }
+  return dram->ready_banks[tRC] & dram->ready_banks[tRP] & dram->ready_banks[tRFC] & ~(dram->refresh_blocked & ~dram->open_banks);
+}
+
+uint32_t precharge_ready_banks(DRAM_t *dram) {
+  // every access to the row has to be done, not only the last one a request was classified as.
+  // deadlines that were never set are in the past, so all of them can be checked
+  return dram->ready_banks[tRAS] & dram->ready_banks[tRTP] & dram->ready_banks[tCWL] &
+         dram->ready_banks[tBURST] & dram->ready_banks[tWR] & dram->ready_banks[tRP];
+}
+
+uint32_t last_cmd_ready_banks(DRAM_t *dram, Commands_t last_cmd, ConsecutiveCmdConstraints_t same_group) {
+  // banks a command can go to after last_cmd, if that was the last command: same_group is the _L
+  // timing for the bank group of the last command and same_group + 1 the _S timing for the others
+  if (dram->last_interface_cmd != last_cmd) {
+    return ALL_BANKS;
+  }
+
+  uint32_t group = (uint32_t)((1ULL << NUM_BANKS_PER_GROUP) - 1) << (dram->last_bank_group * NUM_BANKS_PER_GROUP);
+  return (is_trrd_met(dram, same_group) ? group : 0) | (is_trrd_met(dram, same_group + 1) ? ALL_BANKS & ~group : 0);
+}
+
+void find_movable_banks(DRAM_t *dram, Queue_t *q, uint32_t movable[NUM_REQUEST_STATES]) {
+  /**
+   * @brief For each state, the banks in which open_page can move a request in that state on at
+   *        this cycle, going by the checks the state machine makes. A request left out would
+   *        stay as it is; one that is in may still not move, its place in the queue is not
+   *        looked at.
+   */
+  uint32_t *ready = dram->ready_banks;
+
+  // a pending request is classified unless its bank is held for a refresh or tFAW keeps it from
+  // activating the closed bank. the page predictor is trained first either way
+  uint32_t empty_banks = dram->precharged_banks & ~dram->open_banks;
+  uint32_t classify = ~dram->refresh_blocked & (can_issue_act(dram) ? ALL_BANKS : ~empty_banks | dram->awaiting_access_banks);
+
+  // classifying a request sets what the bank's PRE waits for, so with a pending request both count
+  uint32_t write_precharge = ready[tRAS] & ready[tCWL] & ready[tBURST] & ready[tWR] & ready[tRP];
+  uint32_t read_precharge = ready[tRAS] & ready[tRTP] & ready[tRP];
+  uint32_t classified_banks = queue_state_banks(q, PENDING) & classify;
+  movable[PRE] = (dram->write_banks & write_precharge) | (~dram->write_banks & read_precharge) | (classified_banks & (write_precharge | read_precharge));
+
+  movable[PENDING] = classify;
+  movable[ACT0] = act_ready_banks(dram) & last_cmd_ready_banks(dram, ACTIVATE, tRRD_L);
+  movable[RD0] = ready[tRCD] & last_cmd_ready_banks(dram, WRITE, tCCD_L_WTR) & last_cmd_ready_banks(dram, READ, tCCD_L);
+  movable[WR0] = ready[tRCD] & last_cmd_ready_banks(dram, WRITE, tCCD_L_WR) & last_cmd_ready_banks(dram, READ, tCCD_L_RTW);
+  movable[BUFFER] = ready[tCL] | ready[tCWL];
+  movable[BURST] = ready[tBURST];
+
+  // the second halves of commands always issue, COMPLETE requests are removed
+  movable[ACT1] = ALL_BANKS;
+  movable[RD1] = ALL_BANKS;
+  movable[WR1] = ALL_BANKS;
+  movable[COMPLETE] = ALL_BANKS;
+}
+
+bool is_bank_refresh_blocked(DRAM_t *dram, MemoryRequest_t *request) {
+  // an overdue refresh is waiting for this bank to close, so no new request may open it.
+  // a request that activates a bank that is already open is let through, it may be what keeps the bank busy
+  return (dram->refresh_blocked & request_bank_bit(request)) != 0 &&
+         (request->state == PENDING || !is_bank_active(dram, request));
+}
+
+void update_bank_count(uint32_t *count, uint32_t *banks, int bank, int delta) {
+  // keeps a bank's bit in the mask set while its count is not zero
+  *count += delta;
+  if (*count != 0) {
+    *banks |= (uint32_t)1 << bank;
+  }
+  else {
+    *banks &= ~((uint32_t)1 << bank);
+  }
+}
+
+void count_request(BankRequests_t *requests, int bank, MemoryRequestState_t state, int delta) {
+  // requests waiting to close the row or to activate do not need the row that is open now
+  if (state != PENDING && state != ACT0 && state != PRE && state != COMPLETE) {
+    update_bank_count(&requests->in_flight[bank], &requests->in_flight_banks, bank, delta);
+  }
+  if (state == ACT1) {
+    update_bank_count(&requests->activating[bank], &requests->activating_banks, bank, delta);
+  }
+  if (state == COMPLETE) {
+    update_bank_count(&requests->complete[bank], &requests->complete_banks, bank, delta);
+  }
+}
+
+Queue_t *queue_of(Channel_t *channel, MemoryRequest_t *request) {
+  return (channel->write_queue != NULL && queue_holds(channel->write_queue, request)) ? channel->write_queue : channel->queue;
+}
+
+void track_request(Channel_t *channel, MemoryRequest_t *request, MemoryRequestState_t initial_state) {
+  // the request moved from initial_state to its current state
+  int bank = bank_index(request->bank_group, request->bank);
+  count_request(&channel->requests, bank, initial_state, -1);
+  count_request(&channel->requests, bank, request->state, 1);
+
+  queue_update_state(queue_of(channel, request), request);
+}
+
+void retire_request(Channel_t *channel, Queue_t **q, MemoryRequest_t *request, uint64_t clock) {
+  // removes a COMPLETE request from its queue
+  latency_record(&channel->latency, request, clock);
+  count_request(&channel->requests, bank_index(request->bank_group, request->bank), COMPLETE, -1);
+  queue_remove(q, request);
+}
+
+uint32_t waiting_banks(Channel_t *channel, Queue_t *q, Queue_t *write_q) {
+  // banks with a queued request that is not COMPLETE
+  uint32_t queued_banks = queue_queued_banks(q) | ((write_q != NULL) ? queue_queued_banks(write_q) : 0);
+  uint32_t banks = queued_banks & ~channel->requests.complete_banks;
+
+  for (uint32_t complete_banks = queued_banks & channel->requests.complete_banks; complete_banks != 0; complete_banks &= complete_banks - 1) {
+    int bank = __builtin_ctz(complete_banks);
+    uint32_t count = queue_bank_count(q, bank) + ((write_q != NULL) ? queue_bank_count(write_q, bank) : 0);
+    if (count > channel->requests.complete[bank]) {
+      banks |= (uint32_t)1 << bank;
+    }
+  }
+
+  return banks;
+}
+
+void buffer_write(Channel_t *channel, Queue_t *q, Queue_t *write_q, MemoryRequest_t *write) {
+  /**
+   * @brief Puts a write in the write queue. A write never overtakes an older read of the same
+   *        line, so it counts the queued reads of its line that have not read their data yet;
+   *        its bank is blocked for writes until they have.
+   */
+  int bank = bank_index(write->bank_group, write->bank);
+
+  write->older_reads = 0;
+  for (MemoryRequest_t *read = queue_bank_pending(q, bank); read != NULL; read = queue_bank_next(q, read)) {
+    write->older_reads += is_same_cache_line(read, write);
+  }
+  for (MemoryRequest_t *read = queue_bank_started(q, bank); read != NULL; read = queue_bank_next(q, read)) {
+    write->older_reads += !read->is_finished && is_same_cache_line(read, write);
+  }
+
+  if (write->older_reads > 0) {
+    update_bank_count(&channel->requests.blocked_writes[bank], &channel->requests.blocked_write_banks, bank, 1);
+  }
+  enqueue(&write_q, *write);
+}
+
+void release_buffered_writes(Channel_t *channel, MemoryRequest_t *read) {
+  // the read has its data, the buffered writes of its line no longer wait for it
+  if (channel->write_queue == NULL) {
+    return;
+  }
+
+  int bank = bank_index(read->bank_group, read->bank);
+  for (MemoryRequest_t *write = queue_bank_pending(channel->write_queue, bank); write != NULL; write = queue_bank_next(channel->write_queue, write)) {
+    if (write->older_reads > 0 && is_same_cache_line(write, read) && --write->older_reads == 0) {
+      update_bank_count(&channel->requests.blocked_writes[bank], &channel->requests.blocked_write_banks, bank, -1);
+    }
+  }
+}
+
+void train_page_predictor(Channel_t *channel, DRAM_t *dram, MemoryRequest_t *request) {
+  // the first request after an access tells whether keeping the row open would have paid off
+  int bank = bank_index(request->bank_group, request->bank);
+  if ((dram->awaiting_access_banks & request_bank_bit(request)) == 0) {
+    return;
+  }
+
+  bool is_same_row = dram->active_row[bank] == request->row;
+  if (dram->closed_early_banks & request_bank_bit(request)) {
+    if (is_same_row) {
+      channel->page_predictor.close_misses++;
+    }
+    else {
+      channel->page_predictor.close_hits++;
+    }
+  }
+  else {
+    if (is_same_row) {
+      channel->page_predictor.open_hits++;
+    }
+    else {
+      channel->page_predictor.open_misses++;
+    }
+  }
+
+  if (is_same_row && dram->page_predictor[bank] < PAGE_PREDICTOR_MAX) {
+    dram->page_predictor[bank]++;
+  }
+  else if (!is_same_row && dram->page_predictor[bank] > 0) {
+    dram->page_predictor[bank]--;
+  }
+  dram->awaiting_access_banks &= ~request_bank_bit(request);
+}
+
 void check_requests_age(Queue_t *global_queue){
-  if (global_queue == NULL || global_queue->list == NULL) {
+  if (global_queue == NULL || global_queue->slots == NULL) {
     return; 
   }
 
-  int old_request_age =-1;
-  int young_request_age =-1;
-  for (int i = 0; i < global_queue->size; i++) {
-    MemoryRequest_t *request = queue_peek_at(global_queue, i);
-    if (request != NULL) {
-      if (request->aging >= TRC*8 && old_request_age == -1) {
-        old_request_age = i;
-      } 
-      else if (request->aging < TRC && young_request_age == -1) {
-        young_request_age = i;
-      }
+  MemoryRequest_t *old_request = NULL;
+  MemoryRequest_t *young_request = NULL;
+  bool is_old_ahead = false;
+  for (MemoryRequest_t *request = queue_peek(global_queue); request != NULL; request = queue_next(global_queue, request)) {
+    uint64_t aging = global_queue->cycle - request->enqueue_cycle;
+    if (aging >= timing_profile.timing_attribute[tRC]*8 && old_request == NULL) {
+      old_request = request;
+    } 
+    else if (aging < timing_profile.timing_attribute[tRC] && young_request == NULL) {
+      young_request = request;
+      is_old_ahead = (old_request != NULL);
+    }
 
-      if (old_request_age != -1 && young_request_age != -1) {
-        break;
-      }
+    if (old_request != NULL && young_request != NULL) {
+      break;
     }
   }
 
-  if (old_request_age != -1 && young_request_age != -1) {
-    queue_insert_at(&global_queue, young_request_age,queue_delete_at(&global_queue,old_request_age));
+  if (old_request != NULL && young_request != NULL) {
+    // the old request takes the young one's place; if it was further ahead, the young one has moved up into it
+    MemoryRequest_t *position = is_old_ahead ? queue_next(global_queue, young_request) : young_request;
+    queue_insert_before(&global_queue, position, queue_remove(&global_queue, old_request));
   }
 
 }
 
 void increment_aging_in_queue(Queue_t *global_queue) {
-    if (global_queue == NULL || global_queue->list == NULL) {
+    if (global_queue == NULL || global_queue->slots == NULL) {
         return; 
     }
 
-    for (uint8_t i = 0; i < global_queue->size; i++) {
-        MemoryRequest_t *request = queue_peek_at(global_queue, i);
-        if (request != NULL) {
-            request->aging++; 
-        }
-    }
+    // every queued request ages by one; ages are measured against the queue's cycle
+    global_queue->cycle++;
 }
 
 bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
-  DRAM_t *dram = &((*dimm)->channels[request->channel].DDR5_chip[0]);
-  char *cmd = NULL;
+  Channel_t *channel = &(*dimm)->channels[request->channel];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+  CommandCode_t cmd = CMD_NONE;
   bool cmd_is_issued = false;
+  MemoryRequestState_t initial_state = request->state;
 
   if (request->state == PENDING) {
     request->state = ACT0;
+    channel->bandwidth.row_empties++;
   }
 
   // Process the request (one state per cycle)
@@ -242,17 +592,19 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
     case ACT0:
       if (
         is_timing_constraint_met(dram, request, tRC) &&
-        is_timing_constraint_met(dram, request, tRP)
+        is_timing_constraint_met(dram, request, tRP) &&
+        is_timing_constraint_met(dram, request, tRFC) &&
+        !is_bank_refresh_blocked(dram, request)
       ) {
-        cmd = issue_cmd("ACT0", request, clock);
+        cmd = CMD_ACT0;
         request->state = ACT1;
       }
       break;
 
     case ACT1:
-      activate_bank(dram, request);
+      activate_bank(channel, dram, request);
 
-      cmd = issue_cmd("ACT1", request, clock);
+      cmd = CMD_ACT1;
 
       set_timing_constraint(dram, request, tRCD);
       set_timing_constraint(dram, request, tRAS);
@@ -270,14 +622,14 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
 
     case RD0:
       if (is_timing_constraint_met(dram, request, tRCD)) {
-        cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, clock);
+        cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
         request->state = RD1;
       }
       break;
 
     case RD1:
       // issue cmd
-      cmd = issue_cmd(request->operation == DATA_WRITE ? "WR1" : "RD1", request, clock);
+      cmd = request->operation == DATA_WRITE ? CMD_WR1 : CMD_RD1;
       
 
       // set timers
@@ -290,14 +642,14 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
 
     case WR0:
       if (is_timing_constraint_met(dram, request, tRCD)) {
-        cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, clock);
+        cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
         request->state = WR1;
       }
       break;
 
     case WR1:
       // issue cmd
-      cmd = issue_cmd(request->operation == DATA_WRITE ? "WR1" : "RD1", request, clock);
+      cmd = request->operation == DATA_WRITE ? CMD_WR1 : CMD_RD1;
 
       // set timers
       set_timing_constraint(dram, request, tCWL);
@@ -312,7 +664,7 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
         if (is_timing_constraint_met(dram, request, tWR) && is_timing_constraint_met(dram, request, tRAS)) {
           precharge_bank(dram, request);
 
-          cmd = issue_cmd("PRE", request, clock);
+          cmd = CMD_PRE;
           request->is_finished = true;
 
           set_timing_constraint(dram, request, tRP);
@@ -324,7 +676,7 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
         if (is_timing_constraint_met(dram, request, tRTP) && is_timing_constraint_met(dram, request, tRAS)) {
           precharge_bank(dram, request);
 
-          cmd = issue_cmd("PRE", request, clock);
+          cmd = CMD_PRE;
           request->is_finished = true;
 
           set_timing_constraint(dram, request, tRP);
@@ -354,6 +706,7 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
 
     case BURST:
       if (is_timing_constraint_met(dram, request, tBURST)) {
+        request->data_complete_cycle = clock;
         if (request->operation == DATA_WRITE) {
           set_timing_constraint(dram, request, tWR);
           request->state = PRE;
@@ -375,22 +728,34 @@ bool closed_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t clock) {
   }
 
   // writing commands to output file
-  if (cmd != NULL) {
-    fprintf((*dimm)->output_file, "%s\n", cmd);
-    free(cmd);
+  if (cmd != CMD_NONE) {
+    issue_cmd(channel, cmd, request, clock);
     cmd_is_issued = true;
   }
 
+  if (request->state != initial_state) {
+    channel->is_idle = false;
+    track_request(channel, request, initial_state);
+  }
+
   return cmd_is_issued;
 }
 
 bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
-  DRAM_t *dram = &((*dimm)->channels[request->channel].DDR5_chip[0]);
-  char *cmd = NULL;
+  Channel_t *channel = &(*dimm)->channels[request->channel];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+  CommandCode_t cmd = CMD_NONE;
   bool cmd_is_issued = false;
+  MemoryRequestState_t initial_state = request->state;
 
   // Set the initial state before processing the request
   if (request->state == PENDING) {
+    if (is_bank_refresh_blocked(dram, request)) {
+      return cmd_is_issued;
+    }
+
+    train_page_predictor(channel, dram, request);
+
     if (is_page_hit(dram, request)) {
       if (request->operation == DATA_WRITE) {
         request->state = WR0;
@@ -398,10 +763,12 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
       else {
         request->state = RD0;
       }
-      dram->bank_groups[request->bank_group].banks[request->bank].last_request_operation = request->operation;
+      set_bank_operation(dram, request);
+      channel->bandwidth.row_hits++;
     }
     else if (is_page_miss(dram, request)) {
       request->state = PRE;
+      channel->bandwidth.row_misses++;
     }
     else if (is_page_empty(dram, request)) {
       if (!can_issue_act(dram)) {
@@ -409,7 +776,8 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
       }
 
       request->state = ACT0;
-      dram->bank_groups[request->bank_group].banks[request->bank].last_request_operation = request->operation;
+      set_bank_operation(dram, request);
+      channel->bandwidth.row_empties++;
     }
     else {
       fprintf(stderr, "Error: Unknown page state encountered\n");
@@ -420,7 +788,7 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
   // Process the request (one state per cycle)
   switch (request->state) {
     case PRE:
-      if (dram->bank_groups[request->bank_group].banks[request->bank].last_request_operation == DATA_WRITE) {
+      if (dram->write_banks & request_bank_bit(request)) {
         if (
           is_timing_constraint_met(dram, request, tRAS) &&
           is_timing_constraint_met(dram, request, tCWL) &&
@@ -431,10 +799,10 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
           precharge_bank(dram, request);
 
           // issue cmd
-          cmd = issue_cmd("PRE", request, cycle);
+          cmd = CMD_PRE;
           dram->last_interface_cmd = PRECHARGE;
           dram->last_bank_group = request->bank_group;
-          dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+          set_in_progress(dram, request, true);
 
           // set timers
           set_timing_constraint(dram, request, tRP);
@@ -452,10 +820,10 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
           precharge_bank(dram, request);
 
           // issue cmd
-          cmd = issue_cmd("PRE", request, cycle);
+          cmd = CMD_PRE;
           dram->last_interface_cmd = PRECHARGE;
           dram->last_bank_group = request->bank_group;
-          dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+          set_in_progress(dram, request, true);
 
           // set timers
           set_timing_constraint(dram, request, tRP);
@@ -468,8 +836,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
       break;
 
     case ACT0:
-      if (!can_issue_act(dram)) {
-        return cmd_is_issued;
+      if (!can_issue_act(dram) || !is_timing_constraint_met(dram, request, tRFC) || is_bank_refresh_blocked(dram, request) ||
+          !is_bank_group_timer_met(dram, request->bank_group, tRRD_L)) {
+        break;
       }
 
       if (dram->last_interface_cmd == ACTIVATE) {
@@ -479,9 +848,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRP) &&
             is_trrd_met(dram, tRRD_L)
           ) {
-            cmd = issue_cmd("ACT0", request, cycle);
+            cmd = CMD_ACT0;
             request->state = ACT1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
         else {
@@ -490,9 +859,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRP) &&
             is_trrd_met(dram, tRRD_S)
           ) {
-            cmd = issue_cmd("ACT0", request, cycle);
+            cmd = CMD_ACT0;
             request->state = ACT1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
       }
@@ -501,19 +870,19 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
           is_timing_constraint_met(dram, request, tRC) &&
           is_timing_constraint_met(dram, request, tRP)
         ) {
-          cmd = issue_cmd("ACT0", request, cycle);
+          cmd = CMD_ACT0;
           request->state = ACT1;
-          dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+          set_in_progress(dram, request, true);
         }
       }
 
       break;
 
     case ACT1:
-      activate_bank(dram, request);
+      activate_bank(channel, dram, request);
 
       // issue cmd
-      cmd = issue_cmd("ACT1", request, cycle);
+      cmd = CMD_ACT1;
       dram->last_interface_cmd = ACTIVATE;
       dram->last_bank_group = request->bank_group;
 
@@ -523,6 +892,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
       set_timing_constraint(dram, request, tRC);
       set_trrd_timers(dram);
       set_tfaw_timer(dram);
+      if (dram->is_checking_bank_groups) {
+        set_bank_group_timers(dram, request->bank_group, tRRD_L);
+      }
 
       // next state
       if (request->operation == DATA_WRITE) {
@@ -535,15 +907,19 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
       break;
 
     case RD0:
+      if (!is_bank_group_timer_met(dram, request->bank_group, tCCD_L) || !is_bank_group_timer_met(dram, request->bank_group, tCCD_L_WTR)) {
+        break;
+      }
+
       if (dram->last_interface_cmd == WRITE) {
         if (dram->last_bank_group == request->bank_group) {
           if (
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_L_WTR)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = RD1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
         else {
@@ -552,9 +928,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_S_WTR)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = RD1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
 
@@ -565,9 +941,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_L)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = RD1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
         else {
@@ -575,17 +951,17 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_S)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = RD1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
       }
       else {
         if (is_timing_constraint_met(dram, request, tRCD)) {
-          cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+          cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
           request->state = RD1;
-          dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+          set_in_progress(dram, request, true);
         }
       }
 
@@ -593,30 +969,41 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
 
     case RD1:
       // issue cmd
-      cmd = issue_cmd(request->operation == DATA_WRITE ? "WR1" : "RD1", request, cycle);
+      cmd = request->operation == DATA_WRITE ? CMD_WR1 : CMD_RD1;
       request->is_finished = true;
       dram->last_interface_cmd = READ;
       dram->last_bank_group = request->bank_group;
+      dram->awaiting_access_banks |= request_bank_bit(request);
+      dram->closed_early_banks &= ~request_bank_bit(request);
+      release_buffered_writes(channel, request);
 
       // set timers
       set_timing_constraint(dram, request, tCL);
       set_timing_constraint(dram, request, tRTP);
       set_tccd_timers(dram);
+      if (dram->is_checking_bank_groups) {
+        set_bank_group_timers(dram, request->bank_group, tCCD_L);
+        set_bank_group_timers(dram, request->bank_group, tCCD_L_RTW);
+      }
 
       // nest state
       request->state = BUFFER;
       break;
 
     case WR0:
+      if (!is_bank_group_timer_met(dram, request->bank_group, tCCD_L_WR) || !is_bank_group_timer_met(dram, request->bank_group, tCCD_L_RTW)) {
+        break;
+      }
+
       if (dram->last_interface_cmd == WRITE) {
         if (dram->last_bank_group == request->bank_group) {
           if (
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_L_WR)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = WR1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
         else {
@@ -624,9 +1011,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_S_WR)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = WR1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
       }
@@ -636,9 +1023,9 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_L_RTW)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = WR1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
         else {
@@ -646,31 +1033,37 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
             is_timing_constraint_met(dram, request, tRCD) &&
             is_tccds_met(dram, tCCD_S_RTW)
           ) {
-            cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+            cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
             request->state = WR1;
-            dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+            set_in_progress(dram, request, true);
           }
         }
       }
       else {
         if (is_timing_constraint_met(dram, request, tRCD)) {
-          cmd = issue_cmd(request->operation == DATA_WRITE ? "WR0" : "RD0", request, cycle);
+          cmd = request->operation == DATA_WRITE ? CMD_WR0 : CMD_RD0;
           request->state = WR1;
-          dram->bank_groups[request->bank_group].banks[request->bank].in_progress = true;
+          set_in_progress(dram, request, true);
         }
       }
       break;
 
     case WR1:
       // issue cmd
-      cmd = issue_cmd(request->operation == DATA_WRITE ? "WR1" : "RD1", request, cycle);
+      cmd = request->operation == DATA_WRITE ? CMD_WR1 : CMD_RD1;
       request->is_finished = true;
       dram->last_interface_cmd = WRITE;
       dram->last_bank_group = request->bank_group;
+      dram->awaiting_access_banks |= request_bank_bit(request);
+      dram->closed_early_banks &= ~request_bank_bit(request);
 
       // set timers
       set_timing_constraint(dram, request, tCWL);
       set_tccd_timers(dram);
+      if (dram->is_checking_bank_groups) {
+        set_bank_group_timers(dram, request->bank_group, tCCD_L_WR);
+        set_bank_group_timers(dram, request->bank_group, tCCD_L_WTR);
+      }
 
       // nest state
       request->state = BUFFER;
@@ -694,11 +1087,12 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
 
     case BURST:
       if (is_timing_constraint_met(dram, request, tBURST)) {
+        request->data_complete_cycle = cycle;
         if (request->operation == DATA_WRITE) {
           set_timing_constraint(dram, request, tWR);
         }
         request->state = COMPLETE;
-        dram->bank_groups[request->bank_group].banks[request->bank].in_progress = false;
+        set_in_progress(dram, request, false);
       }
       break;
 
@@ -712,148 +1106,875 @@ bool open_page(DIMM_t **dimm, MemoryRequest_t *request, uint64_t cycle) {
   }
 
   // writing commands to output file
-  if (cmd != NULL) {
-    fprintf((*dimm)->output_file, "%s\n", cmd);
-    free(cmd);
+  if (cmd != CMD_NONE) {
+    issue_cmd(channel, cmd, request, cycle);
     cmd_is_issued = true;
   }
 
+  if (request->state != initial_state) {
+    channel->is_idle = false;
+    track_request(channel, request, initial_state);
+  }
+
   return cmd_is_issued;
 }
 
-void level_zero_algorithm(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
-  MemoryRequest_t *request = queue_peek(*q);
-  DRAM_t *dram = &((*dimm)->channels[request->channel].DDR5_chip[0]);
+uint64_t refresh_interval(RefreshMode_t refresh_mode) {
+  // every bank is refreshed once per tREFI, a bank at a time in same-bank mode
+  return (refresh_mode == REFRESH_SAME_BANK) ? timing_profile.tREFI / NUM_BANKS_PER_GROUP : timing_profile.tREFI;
+}
 
-  if ((*q)->size > 1) {  
-    MemoryRequest_t *next_request = queue_peek_at(*q, 1);
-    if (!request->is_finished) {
-      closed_page(dimm, request, clock);
+int refresh_commands_per_interval(RefreshMode_t refresh_mode) {
+  return (refresh_mode == REFRESH_SAME_BANK) ? NUM_BANKS_PER_GROUP : 1;
+}
+
+uint32_t refresh_target(DRAM_t *dram, RefreshMode_t refresh_mode, uint32_t queued_banks, uint8_t *same_bank) {
+  /**
+   * @brief Picks the banks the next refresh covers. In same-bank mode every bank is refreshed
+   *        once per round, and the bank with the fewest queued requests goes first so refresh
+   *        stays out of the way of hot banks.
+   *
+   * @param queued_banks  banks that queued requests are waiting on
+   * @param same_bank     set to the bank a same-bank refresh covers
+   * @return uint32_t     mask of the banks to refresh
+   */
+  *same_bank = 0;
+
+  if (refresh_mode == REFRESH_ALL_BANK) {
+    return ALL_BANKS;
+  }
+
+  int fewest_requests = NUM_BANKS + 1;
+  uint32_t target = 0;
+  for (uint8_t bank = 0; bank < NUM_BANKS_PER_GROUP; bank++) {
+    uint32_t banks = 0;
+    for (uint8_t bank_group = 0; bank_group < NUM_BANK_GROUPS; bank_group++) {
+      banks |= bank_bit(bank_group, bank);
     }
-    else {
-      closed_page(dimm, request, clock);
-      closed_page(dimm, next_request, clock);
+
+    // an overdue refresh keeps its banks until it is issued
+    if (dram->refresh_blocked != 0) {
+      if ((dram->refresh_blocked & banks) != 0) {
+        *same_bank = bank;
+        return banks;
+      }
+      continue;
     }
-  }
-  else {
-    if (request->state != COMPLETE) {
-      closed_page(dimm, request, clock);
+
+    if (dram->refreshed_banks & (1 << bank)) {
+      continue;
+    }
+
+    int requests = __builtin_popcount(queued_banks & banks);
+    if (requests < fewest_requests) {
+      fewest_requests = requests;
+      target = banks;
+      *same_bank = bank;
     }
   }
 
-  if (request && request->state == COMPLETE) {
-    log_memory_request("Dequeued:", request, clock);
-    dequeue(q);
+  return target;
+}
+
+void issue_bank_cmd(Channel_t *channel, uint8_t channel_id, CommandCode_t cmd, uint8_t bank_group, uint8_t bank, uint64_t cycle) {
+  CommandRecord_t record = {
+    .cycle = cycle,
+    .channel = channel_id,
+    .command = cmd,
+    .bank_group = bank_group,
+    .bank = bank,
+    .address = 0
+  };
+
+  command_trace_write(channel->commands, &record);
+  count_cmd(channel, cmd, bank_group, bank, cycle);
+  if (channel->timeline != NULL) {
+    timeline_record(channel->timeline, cmd, bank_group, bank, 0, cycle);
   }
+  channel->is_idle = false;
+}
 
-  decrement_timing_constraints(dram);
+void precharge_idle_bank(Channel_t *channel, uint8_t channel_id, DRAM_t *dram, uint8_t bank_group, uint8_t bank, uint64_t clock) {
+  // closes a row that no request is using, outside of any request's state machine
+  dram->open_banks &= ~bank_bit(bank_group, bank);
+  dram->precharged_banks |= bank_bit(bank_group, bank);
+  dram->last_interface_cmd = PRECHARGE;
+  dram->last_bank_group = bank_group;
+  set_bank_timer(dram, bank_index(bank_group, bank), tRP, dram->cycle + timing_profile.timing_attribute[tRP]);
+  issue_bank_cmd(channel, channel_id, CMD_PRE, bank_group, bank, clock);
 }
 
-void level_one_algorithm(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
-  MemoryRequest_t *request = queue_peek(*q);
-  DRAM_t *dram = &((*dimm)->channels[request->channel].DDR5_chip[0]);
+void refresh_scheduler(DIMM_t *dimm, uint8_t channel_id, Queue_t *q, Queue_t *write_q, uint64_t clock, bool is_bus_free) {
+  /**
+   * @brief Keeps the channel refreshed. Refreshes fall due every tREFI (per bank in same-bank
+   *        mode) and are postponed while the banks they cover have requests waiting. Cold banks
+   *        are refreshed early (pulled in) while the bus is free. Once the maximum number of
+   *        refreshes is owed, the banks are closed to new requests, precharged, and refreshed.
+   *
+   * @param is_bus_free  true if the scheduler issued no command this cycle
+   */
+  Channel_t *channel = &dimm->channels[channel_id];
+  DRAM_t *dram = &channel->DDR5_chip[0];
 
-  // if current request is not finish, finish it
-  if (!request->is_finished) {
-    open_page(dimm, request, clock);
+  if (dimm->refresh_mode == REFRESH_OFF) {
+    return;
   }
-  // else if current request is finish, start next request
-  else {
-    for (int i = 0; i < (*q)->size; i++) {
-      MemoryRequest_t *next_request = queue_peek_at(*q, i);
-      open_page(dimm, next_request, clock);
 
-      if (!next_request->is_finished) {
-        break;
-      }
-    }
+  int commands_per_interval = refresh_commands_per_interval(dimm->refresh_mode);
+  while (dram->cycle >= dram->refresh_due_at) {
+    dram->refresh_credit--;
+    dram->refresh_due_at += refresh_interval(dimm->refresh_mode);
+    schedule_expiry(dram, dram->refresh_due_at);
+    channel->is_idle = false;
   }
 
-  // if current request is ready to be dequeue, delete it
-  if (request && request->state == COMPLETE) {
-    log_memory_request("Dequeued:", request, clock);
-    dequeue(q);
+  bool is_overdue = dram->refresh_credit <= -MAX_POSTPONED_REFRESHES * commands_per_interval;
+  if (!is_overdue && dram->refresh_credit >= MAX_PULLED_IN_REFRESHES * commands_per_interval) {
+    return;
   }
-  
-  decrement_tfaw_timers(dram);
-  decrement_timing_constraints(dram);
-  decrement_consecutive_cmd_timers(dram);
-}
 
-void bank_level_parallelism(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
-  bool is_cmd_issued = false;
-  DRAM_t *dram = &((*dimm)->channels[0].DDR5_chip[0]);
+  uint32_t queued_banks = waiting_banks(channel, q, write_q);
+  uint32_t in_flight_banks = channel->requests.in_flight_banks;
+  uint32_t activating_banks = channel->requests.activating_banks;
 
-  for (int index = 0; index < (*q)->size; index++) {
-    MemoryRequest_t *request = queue_peek_at(*q, index);
+  uint8_t same_bank;
+  uint32_t target = refresh_target(dram, dimm->refresh_mode, queued_banks, &same_bank);
 
-    // delete once done
-    if (request->state == COMPLETE) {
-      queue_delete_at(q, index);
-      index--; // decrement index to account for the deleted element
-      continue;
-    }
+  // postpone while requests are waiting on the banks, until that is no longer allowed
+  if (!is_overdue && (target & queued_banks) != 0) {
+    return;
+  }
 
-    if (request->is_finished) {
-      open_page(dimm, request, clock);
-      continue;
-    }
+  if (is_overdue && dram->refresh_blocked != target) {
+    dram->refresh_blocked = target;
+    channel->is_idle = false;
+  }
 
-    if (index != 0) {
+  if (!is_bus_free || (target & activating_banks) != 0) {
+    return;
+  }
 
-      MemoryRequest_t *last_request = queue_peek_at(*q, index - 1);
-      if (
-        !last_request->is_finished &&
-        last_request->bank_group == request->bank_group &&
-        last_request->bank == request->bank
-      ) {
-        continue;
-      }
+  // every bank has to be precharged first, close idle rows one at a time, lowest bank first
+  uint32_t closable_banks = target & dram->open_banks & ~in_flight_banks & precharge_ready_banks(dram);
+  if (closable_banks != 0) {
+    int bank = __builtin_ctz(closable_banks);
+    precharge_idle_bank(channel, channel_id, dram, bank / NUM_BANKS_PER_GROUP, bank % NUM_BANKS_PER_GROUP, clock);
+    dram->awaiting_access_banks &= ~((uint32_t)1 << bank);  // the page policy did not decide this one
+    return;
+  }
 
-    }
+  if ((target & (dram->open_banks | ~dram->ready_banks[tRP] | ~dram->ready_banks[tRFC])) != 0) {
+    return;
+  }
 
-    is_cmd_issued = open_page(dimm, request, clock);
+  uint32_t duration = (dimm->refresh_mode == REFRESH_SAME_BANK) ? timing_profile.tRFCsb : timing_profile.timing_attribute[tRFC];
+  for (uint32_t banks = target; banks != 0; banks &= banks - 1) {
+    set_bank_timer(dram, __builtin_ctz(banks), tRFC, dram->cycle + duration);
+  }
 
-    if (is_cmd_issued) {
-      break;
+  if (dimm->refresh_mode == REFRESH_SAME_BANK) {
+    dram->refreshed_banks |= 1 << same_bank;
+    if (dram->refreshed_banks == (1 << NUM_BANKS_PER_GROUP) - 1) {
+      dram->refreshed_banks = 0;  // every bank is refreshed, start a new round
     }
+    issue_bank_cmd(channel, channel_id, CMD_REFSB, 0, same_bank, clock);
+  }
+  else {
+    issue_bank_cmd(channel, channel_id, CMD_REF, 0, 0, clock);
   }
 
-  decrement_timing_constraints(dram);
-  decrement_consecutive_cmd_timers(dram);
-  decrement_tfaw_timers(dram);
+  dram->refresh_credit++;
+  dram->refresh_blocked = 0;
 }
 
-void dram_init(DRAM_t *dram) {
-  // Initialize the DRAM with all banks precharged
-  for (int i = 0; i < NUM_BANK_GROUPS; i++) {
-    for (int j = 0; j < NUM_BANKS_PER_GROUP; j++) {
-      dram->bank_groups[i].banks[j].is_precharged = true;
-      dram->bank_groups[i].banks[j].is_active = false;
-      dram->bank_groups[i].banks[j].active_row = 0;
-      dram->bank_groups[i].banks[j].in_progress = false;
+/*** stall attribution ***/
+const char *stall_cause_names[NUM_STALL_CAUSES] = {
+  "tRCD", "tRP", "tRC", "tRAS", "tRTP", "tWR", "tRFC", "tFAW", "tRRD_L", "tRRD_S",
+  "tCCD_L", "tCCD_S", "tCCD_L_WR", "tCCD_S_WR", "tCCD_L_RTW", "tCCD_S_RTW", "tCCD_L_WTR", "tCCD_S_WTR",
+  "refresh", "bank busy", "scheduler", "queue full"
+};
+
+bool is_waiting_on(uint64_t ready_at, uint64_t cycle, uint64_t *until) {
+  if (ready_at > cycle) {
+    *until = ready_at;
+    return true;
+  }
+  return false;
+}
+
+StallCause_t bank_group_stall_cause(DRAM_t *dram, uint8_t bank_group, ConsecutiveCmdConstraints_t same_group, uint64_t cycle, uint64_t *until) {
+  if (is_waiting_on(dram->bank_group_ready_at[same_group][bank_group], cycle, until)) {
+    return STALL_tRRD_L + (same_group - tRRD_L);
+  }
+  if (is_waiting_on(dram->rank_ready_at[same_group + 1], cycle, until)) {
+    return STALL_tRRD_L + (same_group + 1 - tRRD_L);
+  }
+  return NUM_STALL_CAUSES;
+}
+
+StallCause_t act_stall_cause(DRAM_t *dram, MemoryRequest_t *request, bool is_closed_page, uint64_t cycle, uint64_t *until) {
+  int bank = bank_index(request->bank_group, request->bank);
+
+  if (is_bank_refresh_blocked(dram, request)) {
+    return STALL_REFRESH;
+  }
+  if (!is_closed_page) {
+    // any expired tFAW counter allows the ACT
+    uint64_t tfaw_ready_at = UINT64_MAX;
+    for (int i = 0; i < NUM_TFAW_COUNTERS; i++) {
+      if (dram->tFAW_ready_at[i] < tfaw_ready_at) {
+        tfaw_ready_at = dram->tFAW_ready_at[i];
+      }
+    }
+    if (is_waiting_on(tfaw_ready_at, cycle, until)) {
+      return STALL_tFAW;
+    }
+  }
+  if (is_waiting_on(dram->timing_ready_at[tRFC][bank], cycle, until)) {
+    return STALL_tRFC;
+  }
+  if (is_waiting_on(dram->timing_ready_at[tRC][bank], cycle, until)) {
+    return STALL_tRC;
+  }
+  if (is_waiting_on(dram->timing_ready_at[tRP][bank], cycle, until)) {
+    return STALL_tRP;
+  }
+  if (dram->is_checking_bank_groups) {
+    return bank_group_stall_cause(dram, request->bank_group, tRRD_L, cycle, until);
+  }
+  if (!is_closed_page && dram->last_interface_cmd == ACTIVATE) {
+    ConsecutiveCmdConstraints_t constraint = (dram->last_bank_group == request->bank_group) ? tRRD_L : tRRD_S;
+    if (is_waiting_on(dram->consecutive_cmd_ready_at[constraint], cycle, until)) {
+      return STALL_tRRD_L + (constraint - tRRD_L);
+    }
+  }
+  return NUM_STALL_CAUSES;
+}
+
+StallCause_t column_stall_cause(DRAM_t *dram, MemoryRequest_t *request, bool is_write, bool is_closed_page, uint64_t cycle, uint64_t *until) {
+  bool is_same_bank_group = dram->last_bank_group == request->bank_group;
+  ConsecutiveCmdConstraints_t constraint;
+
+  if (is_waiting_on(dram->timing_ready_at[tRCD][bank_index(request->bank_group, request->bank)], cycle, until)) {
+    return STALL_tRCD;
+  }
+  if (is_closed_page) {
+    return NUM_STALL_CAUSES;
+  }
+
+  if (dram->is_checking_bank_groups) {
+    StallCause_t cause = bank_group_stall_cause(dram, request->bank_group, is_write ? tCCD_L_WR : tCCD_L, cycle, until);
+    if (cause == NUM_STALL_CAUSES) {
+      cause = bank_group_stall_cause(dram, request->bank_group, is_write ? tCCD_L_RTW : tCCD_L_WTR, cycle, until);
+    }
+    return cause;
+  }
+
+  if (dram->last_interface_cmd == WRITE) {
+    constraint = is_write ? (is_same_bank_group ? tCCD_L_WR : tCCD_S_WR) : (is_same_bank_group ? tCCD_L_WTR : tCCD_S_WTR);
+  }
+  else if (dram->last_interface_cmd == READ) {
+    constraint = is_write ? (is_same_bank_group ? tCCD_L_RTW : tCCD_S_RTW) : (is_same_bank_group ? tCCD_L : tCCD_S);
+  }
+  else {
+    return NUM_STALL_CAUSES;
+  }
+
+  if (is_waiting_on(dram->consecutive_cmd_ready_at[constraint], cycle, until)) {
+    return STALL_tRRD_L + (constraint - tRRD_L);
+  }
+  return NUM_STALL_CAUSES;
+}
+
+StallCause_t pre_stall_cause(DRAM_t *dram, MemoryRequest_t *request, bool is_closed_page, uint64_t cycle, uint64_t *until) {
+  int bank = bank_index(request->bank_group, request->bank);
+  bool is_write = is_closed_page ? request->operation == DATA_WRITE : (dram->write_banks & request_bank_bit(request)) != 0;
+
+  if (is_waiting_on(dram->timing_ready_at[tRAS][bank], cycle, until)) {
+    return STALL_tRAS;
+  }
+  if (is_write) {
+    if (is_waiting_on(dram->timing_ready_at[tWR][bank], cycle, until) ||
+        (!is_closed_page && (is_waiting_on(dram->timing_ready_at[tCWL][bank], cycle, until) ||
+                             is_waiting_on(dram->timing_ready_at[tBURST][bank], cycle, until)))) {
+      return STALL_tWR;
+    }
+  }
+  else if (is_waiting_on(dram->timing_ready_at[tRTP][bank], cycle, until)) {
+    return STALL_tRTP;
+  }
+  if (!is_closed_page && is_waiting_on(dram->timing_ready_at[tRP][bank], cycle, until)) {
+    return STALL_tRP;
+  }
+  return NUM_STALL_CAUSES;
+}
+
+StallCause_t find_stall_cause(DRAM_t *dram, MemoryRequest_t *request, bool is_closed_page, uint64_t cycle, uint64_t *until) {
+  /**
+   * @brief Finds why a request cannot issue its next command at a dram cycle, checking the
+   *        constraints in the order the state machines do.
+   *
+   * @param until  set to the dram cycle a timing cause ends at; left alone otherwise
+   * @return StallCause_t  NUM_STALL_CAUSES if the request is not waiting for a command
+   */
+  StallCause_t cause = NUM_STALL_CAUSES;
+
+  switch (request->state) {
+    case PENDING:
+      if (is_bank_refresh_blocked(dram, request)) {
+        return STALL_REFRESH;
+      }
+      if (is_closed_page || is_page_empty(dram, request)) {
+        cause = act_stall_cause(dram, request, is_closed_page, cycle, until);
+      }
+      else if (is_page_hit(dram, request)) {
+        cause = column_stall_cause(dram, request, request->operation == DATA_WRITE, false, cycle, until);
+      }
+      else {
+        cause = pre_stall_cause(dram, request, false, cycle, until);
+      }
+      if (cause == NUM_STALL_CAUSES) {
+        cause = (dram->in_progress_banks & request_bank_bit(request)) ? STALL_BANK_BUSY : STALL_SCHEDULER;
+      }
+      return cause;
+
+    case ACT0:
+      cause = act_stall_cause(dram, request, is_closed_page, cycle, until);
+      break;
+
+    case RD0:
+    case WR0:
+      cause = column_stall_cause(dram, request, request->state == WR0, is_closed_page, cycle, until);
+      break;
+
+    case PRE:
+      cause = pre_stall_cause(dram, request, is_closed_page, cycle, until);
+      break;
+
+    default:  // second halves of commands and data transfers never wait
+      return NUM_STALL_CAUSES;
+  }
+
+  return (cause == NUM_STALL_CAUSES) ? STALL_SCHEDULER : cause;
+}
+
+void record_stalls(StallStats_t *stalls, DRAM_t *dram, Queue_t *q, uint64_t cycles) {
+  // every cycle from dram->cycle on is given to the cause that holds the request back at that cycle
+  for (MemoryRequest_t *request = queue_peek(q); request != NULL; request = queue_next(q, request)) {
+    int bank = bank_index(request->bank_group, request->bank);
+    uint64_t cycle = dram->cycle;
+    uint64_t end = dram->cycle + cycles;
+
+    if (request == stalls->issuing_request) {
+      continue;
+    }
+
+    while (cycle < end) {
+      uint64_t until = UINT64_MAX;
+      StallCause_t cause = find_stall_cause(dram, request, stalls->is_closed_page, cycle, &until);
+      if (cause == NUM_STALL_CAUSES) {
+        break;
+      }
+
+      uint64_t stop = (until < end) ? until : end;
+      stalls->cycles[bank][cause] += cpu_cycle_of(stop) - cpu_cycle_of(cycle);
+      cycle = stop;
+    }
+  }
+}
+
+void record_queue_full(Channel_t *channel, MemoryRequest_t *request, uint64_t cycles) {
+  if (channel->stalls != NULL) {
+    channel->stalls->cycles[bank_index(request->bank_group, request->bank)][STALL_QUEUE_FULL] += cycles;
+  }
+}
+
+void level_zero_algorithm(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
+  MemoryRequest_t *request = queue_peek(*q);
+
+  if ((*q)->size > 1) {  
+    MemoryRequest_t *next_request = queue_next(*q, request);
+    if (!request->is_finished) {
+      closed_page(dimm, request, clock);
+    }
+    else {
+      closed_page(dimm, request, clock);
+      closed_page(dimm, next_request, clock);
+    }
+  }
+  else {
+    if (request->state != COMPLETE) {
+      closed_page(dimm, request, clock);
+    }
+  }
+
+  if (request && request->state == COMPLETE) {
+    log_memory_request("Dequeued:", request, clock);
+    retire_request(&(*dimm)->channels[request->channel], q, request, clock);
+  }
+}
+
+void level_one_algorithm(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
+  MemoryRequest_t *request = queue_peek(*q);
+
+  // if current request is not finish, finish it
+  if (!request->is_finished) {
+    open_page(dimm, request, clock);
+  }
+  // else if current request is finish, start next request
+  else {
+    for (MemoryRequest_t *next_request = request; next_request != NULL; next_request = queue_next(*q, next_request)) {
+      open_page(dimm, next_request, clock);
 
-      // zero out bank timers
-      for (int k = 0; k < NUM_TIMING_CONSTRAINTS; k++) {
-        dram->timing_constraints[i][j][k] = 0;
+      if (!next_request->is_finished) {
+        break;
       }
     }
   }
 
-  // zero out dram timers
+  // if current request is ready to be dequeue, delete it
+  if (request && request->state == COMPLETE) {
+    log_memory_request("Dequeued:", request, clock);
+    retire_request(&(*dimm)->channels[request->channel], q, request, clock);
+  }
+}
+
+typedef struct WalkCursor {
+  uint64_t key;              // queue order key of request
+  MemoryRequest_t *request;  // next request of a bank list in the walk
+} WalkCursor_t;
+
+void sift_down_cursor(WalkCursor_t *cursors, int count, int i) {
+  // restores the min-heap of cursors below i
+  while (true) {
+    int first = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if (left < count && cursors[left].key < cursors[first].key) {
+      first = left;
+    }
+    if (right < count && cursors[right].key < cursors[first].key) {
+      first = right;
+    }
+    if (first == i) {
+      return;
+    }
+
+    WalkCursor_t swap = cursors[i];
+    cursors[i] = cursors[first];
+    cursors[first] = swap;
+    i = first;
+  }
+}
+
+bool is_behind_same_bank(DRAM_t *dram, Queue_t *q, MemoryRequest_t *request) {
+  // the request just ahead of it in the queue goes to the same bank and has not finished.
+  // a request held back by a refresh must not hold back the one that keeps the bank open
+  MemoryRequest_t *last_request = queue_prev(q, request);
+  return last_request != NULL &&
+         !last_request->is_finished &&
+         last_request->bank_group == request->bank_group &&
+         last_request->bank == request->bank &&
+         !is_bank_refresh_blocked(dram, last_request);
+}
+
+MemoryRequest_t *walk_next(Queue_t *q, MemoryRequest_t *request) {
+  // pending requests behind a pending request to the same bank are held back, so only the
+  // leading ones are walked
+  return (request->state == PENDING) ? queue_leader_next(q, request) : queue_state_next(q, request);
+}
+
+MemoryRequest_t *first_movable(DRAM_t *dram, Queue_t *q, MemoryRequest_t *request) {
+  // from request on, the first request of its state list that is not held back by the one ahead
+  // of it. removing finished requests ahead of it never lets it go, only finishing the one ahead
+  // does, which issues a command and ends the walk
+  while (request != NULL && !request->is_finished && is_behind_same_bank(dram, q, request)) {
+    request = walk_next(q, request);
+  }
+  return request;
+}
+
+void bank_level_parallelism(DIMM_t **dimm, Queue_t **q, uint64_t clock) {
+  /**
+   * @brief Goes down the queue and moves on every request that is not behind an unfinished
+   *        request to the same bank, until one issues a command. Only requests that can move at
+   *        this cycle are walked, by merging the bank lists of the states they are in by queue
+   *        order; the others would stay as they are, so the walk passes them over.
+   */
+  Channel_t *channel = &(*dimm)->channels[queue_peek(*q)->channel];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+  uint32_t movable[NUM_REQUEST_STATES];
+  WalkCursor_t cursors[NUM_REQUEST_STATES * NUM_BANKS];
+  int count = 0;
+  bool is_cmd_issued = false;
+
+  find_movable_banks(dram, *q, movable);
+  for (int state = PENDING; state < NUM_REQUEST_STATES; state++) {
+    for (uint32_t banks = queue_state_banks(*q, state) & movable[state]; banks != 0; banks &= banks - 1) {
+      int bank = __builtin_ctz(banks);
+      MemoryRequest_t *first = (state == PENDING) ? queue_bank_leader(*q, bank) : queue_bank_state(*q, bank, state);
+      MemoryRequest_t *request = first_movable(dram, *q, first);
+      if (request != NULL) {
+        cursors[count++] = (WalkCursor_t){queue_order_key(*q, request), request};
+      }
+    }
+  }
+  for (int i = count / 2 - 1; i >= 0; i--) {
+    sift_down_cursor(cursors, count, i);
+  }
+
+  while (count > 0) {
+    // a request that changes state is filed ahead of its new list's cursor, so it is not seen twice
+    MemoryRequest_t *request = cursors[0].request;
+    MemoryRequest_t *next = first_movable(dram, *q, walk_next(*q, request));
+    if (next != NULL) {
+      cursors[0] = (WalkCursor_t){queue_order_key(*q, next), next};
+    }
+    else {
+      cursors[0] = cursors[--count];
+    }
+    sift_down_cursor(cursors, count, 0);
+
+    // delete once done
+    if (request->state == COMPLETE) {
+      retire_request(channel, q, request, clock);
+      continue;
+    }
+
+    if (request->is_finished) {
+      open_page(dimm, request, clock);
+      continue;
+    }
+
+    // every COMPLETE request ahead of it has been removed, as in a walk over the whole queue
+    if (is_behind_same_bank(dram, *q, request)) {
+      continue;
+    }
+
+    is_cmd_issued = open_page(dimm, request, clock);
+
+    if (is_cmd_issued) {
+      break;
+    }
+  }
+}
+
+typedef struct BankIndex {
+  MemoryRequest_t *oldest_hit[NUM_BANKS];   // RD/WR to the open row
+  MemoryRequest_t *opener[NUM_BANKS];       // request closing the bank or opening its row
+  MemoryRequest_t *oldest_miss[NUM_BANKS];  // request that has to open another row
+  uint32_t busy_banks;                      // banks whose open row is still needed
+} BankIndex_t;
+
+bool is_older(MemoryRequest_t *request, MemoryRequest_t *other) {
+  // within a queue the order is arrival order, so a tie keeps the request indexed first
+  return other == NULL || request->time < other->time;
+}
+
+bool is_indexed_before(Queue_t *q, MemoryRequest_t *request, MemoryRequest_t *other) {
+  // a bank's requests are indexed started before pending, so a tie within q goes by queue order.
+  // other is from the read queue if it is not in q, which was indexed first and keeps the tie
+  if (other == NULL || request->time != other->time) {
+    return is_older(request, other);
+  }
+  return queue_holds(q, other) && queue_is_ahead(q, request, other);
+}
+
+bool index_queue(DIMM_t **dimm, DRAM_t *dram, Queue_t **q, BankIndex_t *index, uint32_t eligible_banks, uint64_t clock) {
+  /**
+   * @brief Adds the requests of a queue to the bank index, from the queue's bank lists.
+   *        Requests that already started an access are always indexed. Of the pending ones,
+   *        only the oldest row hit and the oldest row miss of a bank can be chosen, so the
+   *        pending list of an eligible bank is only walked until both are found.
+   *
+   * @param eligible_banks  banks whose pending requests may be scheduled
+   * @return bool           true if a request in flight issued a command
+   */
+  bool is_cmd_issued = false;
+
+  // banks do not share the timers the started requests wait on, so they can go bank by bank
+  for (uint32_t banks = (*q)->started_banks; banks != 0; banks &= banks - 1) {
+    int bank = __builtin_ctz(banks);
+    uint32_t bit = (uint32_t)1 << bank;
+
+    for (MemoryRequest_t *request = queue_bank_started(*q, bank), *next; request != NULL; request = next) {
+      next = queue_bank_next(*q, request);
+
+      switch (request->state) {
+        case COMPLETE:
+          retire_request(&(*dimm)->channels[request->channel], q, request, clock);
+          break;
+
+        case RD0:
+        case WR0:
+          if (is_indexed_before(*q, request, index->oldest_hit[bank])) {
+            index->oldest_hit[bank] = request;
+          }
+          index->busy_banks |= bit;
+          break;
+
+        case PRE:
+          // the bank was already closed (by a refresh), go straight to the ACT
+          if (!is_bank_active(dram, request)) {
+            request->state = ACT0;
+            (*dimm)->channels[request->channel].is_idle = false;
+            track_request(&(*dimm)->channels[request->channel], request, PRE);
+          }
+          index->opener[bank] = request;
+          break;
+
+        case ACT0:
+          index->opener[bank] = request;
+          break;
+
+        default:
+          // second half of a two-cycle command or data on the bus, nothing to choose.
+          // lookahead: a read is done with its row once the RD is issued, so the bank can be
+          // precharged and activated for the next row while the data is still on the bus
+          if (request->operation == DATA_WRITE || (request->state != BUFFER && request->state != BURST)) {
+            index->busy_banks |= bit;
+          }
+          is_cmd_issued |= open_page(dimm, request, clock);
+          break;
+      }
+    }
+  }
+
+  // a bank held closed for a refresh takes no new requests
+  for (uint32_t banks = queue_state_banks(*q, PENDING) & eligible_banks & ~dram->refresh_blocked; banks != 0; banks &= banks - 1) {
+    int bank = __builtin_ctz(banks);
+    MemoryRequest_t *hit = NULL, *miss = queue_bank_pending(*q, bank);
+
+    // with the bank closed or no request to its open row, the oldest request is the miss. with a
+    // hit the bank is busy and its miss is never used, so only the hit is looked for
+    if ((dram->open_banks & ((uint32_t)1 << bank)) != 0 && queue_open_row_pending(*q, bank) > 0) {
+      for (hit = miss; hit != NULL && !is_page_hit(dram, hit); hit = queue_bank_next(*q, hit)) {
+      }
+      miss = NULL;
+    }
+
+    if (hit != NULL) {
+      if (is_indexed_before(*q, hit, index->oldest_hit[bank])) {
+        index->oldest_hit[bank] = hit;
+      }
+      index->busy_banks |= (uint32_t)1 << bank;
+    }
+    if (miss != NULL && is_indexed_before(*q, miss, index->oldest_miss[bank])) {
+      index->oldest_miss[bank] = miss;
+    }
+  }
+
+  return is_cmd_issued;
+}
+
+bool issue_oldest_ready(DIMM_t **dimm, MemoryRequest_t *candidates[NUM_BANKS], uint64_t clock) {
+  /**
+   * @brief Tries the candidate of every bank from the oldest to the youngest until one of them
+   *        issues a command.
+   *
+   * @param candidates  each bank's candidate, or NULL
+   * @return bool       true if a command was issued
+   */
+  MemoryRequest_t *order[NUM_BANKS];
+  int count = 0;
+
+  // at most one candidate per bank, so insertion sort is enough
+  for (int bank = 0; bank < NUM_BANKS; bank++) {
+    if (candidates[bank] == NULL) {
+      continue;
+    }
+
+    int i = count++;
+    while (i > 0 && is_older(candidates[bank], order[i - 1])) {
+      order[i] = order[i - 1];
+      i--;
+    }
+    order[i] = candidates[bank];
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (open_page(dimm, order[i], clock)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void update_write_drain(Channel_t *channel, Queue_t *q, Queue_t *write_q) {
+  // start draining at the high watermark or when no read is waiting, stop at the low watermark
+  bool was_draining = channel->is_draining_writes;
+
+  if (queue_is_empty(write_q)) {
+    channel->is_draining_writes = false;
+  }
+  else if (queue_is_empty(q) || write_q->size >= WRITE_HIGH_WATERMARK(write_q->max_size)) {
+    channel->is_draining_writes = true;
+  }
+  else if (write_q->size <= WRITE_LOW_WATERMARK(write_q->max_size)) {
+    channel->is_draining_writes = false;
+  }
+
+  if (channel->is_draining_writes != was_draining) {
+    channel->is_idle = false;
+  }
+}
+
+bool close_predicted_row(DIMM_t *dimm, uint8_t channel_id, BankIndex_t *index, uint64_t clock) {
+  /**
+   * @brief Adaptive page policy. Closes the first open row whose bank predicts the next access
+   *        will go to another row, so that access only pays for the ACT. Only rows no queued
+   *        request is using or waiting on are closed.
+   *
+   * @return bool  true if a PRE was issued
+   */
+  Channel_t *channel = &dimm->channels[channel_id];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+
+  uint32_t banks = dram->open_banks & dram->awaiting_access_banks & ~index->busy_banks & precharge_ready_banks(dram);
+
+  for (; banks != 0; banks &= banks - 1) {
+    int bank = __builtin_ctz(banks);
+
+    if (dram->page_predictor[bank] >= PAGE_PREDICTOR_KEEP_OPEN || index->opener[bank] != NULL || index->oldest_miss[bank] != NULL) {
+      continue;
+    }
+
+    precharge_idle_bank(channel, channel_id, dram, bank / NUM_BANKS_PER_GROUP, bank % NUM_BANKS_PER_GROUP, clock);
+    dram->closed_early_banks |= (uint32_t)1 << bank;
+    return true;
+  }
+
+  return false;
+}
+
+static inline __attribute__((always_inline)) void fr_fcfs(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t clock, bool is_adaptive) {
+  /**
+   * @brief First-ready, first-come first-served. One pass over the queue indexes the requests
+   *        by bank, then the oldest row hit whose column command is ready is issued, or else the
+   *        oldest ready PRE/ACT. A row is only closed once no queued request hits it, and each
+   *        bank has at most one request opening a row at a time. A bank whose reads are only
+   *        waiting for their data is free for its next PRE/ACT, as soon as tRTP/tRAS allow.
+   *
+   *        With a write queue, reads are scheduled until writes are drained. Draining only
+   *        schedules writes, except in banks where a write has to wait for an older read to the
+   *        same line; those banks keep scheduling reads.
+   *
+   * @param is_adaptive  close rows early when the bank predicts a row miss (adaptive page policy)
+   */
+  Channel_t *channel = &(*dimm)->channels[channel_id];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+  BankIndex_t index = {0};
+  bool is_cmd_issued = false;
+
+  if (write_q == NULL) {
+    is_cmd_issued = index_queue(dimm, dram, q, &index, ALL_BANKS, clock);
+  }
+  else {
+    update_write_drain(channel, *q, *write_q);
+
+    uint32_t read_banks = ALL_BANKS, write_banks = 0;
+    if (channel->is_draining_writes) {
+      read_banks = channel->requests.blocked_write_banks;
+      write_banks = ALL_BANKS & ~read_banks;
+    }
+
+    is_cmd_issued = index_queue(dimm, dram, q, &index, read_banks, clock);
+    is_cmd_issued |= index_queue(dimm, dram, write_q, &index, write_banks, clock);
+  }
+
+  if (is_cmd_issued) {
+    return;
+  }
+
+  // a request already waiting at its RD/WR or ACT cannot issue it while its bank's timers run,
+  // so those are dropped up front. pending requests still go through their first state change
+  uint32_t column_ready_banks = dram->ready_banks[tRCD];
+  uint32_t activate_ready_banks = act_ready_banks(dram);
+  uint32_t precharge_banks = ~dram->open_banks | precharge_ready_banks(dram);
+
+  // first ready: row hits before anything else
+  for (int bank = 0; bank < NUM_BANKS; bank++) {
+    MemoryRequest_t *hit = index.oldest_hit[bank];
+    if (hit != NULL && hit->state != PENDING && (column_ready_banks & ((uint32_t)1 << bank)) == 0) {
+      index.oldest_hit[bank] = NULL;
+    }
+  }
+  if (issue_oldest_ready(dimm, index.oldest_hit, clock)) {
+    return;
+  }
+
+  // then the oldest PRE/ACT to a bank whose open row nobody needs.
+  // a PRE waits until every access to the row is done
+  MemoryRequest_t *candidates[NUM_BANKS];
+  for (int bank = 0; bank < NUM_BANKS; bank++) {
+    uint32_t bit = (uint32_t)1 << bank;
+    candidates[bank] = NULL;
+    if ((index.busy_banks & bit) == 0 && (precharge_banks & bit) != 0) {
+      candidates[bank] = (index.opener[bank] != NULL) ? index.opener[bank] : index.oldest_miss[bank];
+    }
+
+    if (candidates[bank] != NULL && candidates[bank]->state == ACT0 && (activate_ready_banks & bit) == 0) {
+      candidates[bank] = NULL;
+    }
+  }
+
+  if (issue_oldest_ready(dimm, candidates, clock)) {
+    return;
+  }
+
+  // the bus is still free, close the rows the predictor does not expect to be hit again
+  if (is_adaptive) {
+    close_predicted_row(*dimm, channel_id, &index, clock);
+  }
+}
+
+void dram_init(DRAM_t *dram) {
+  // Initialize the DRAM with all banks precharged
+  dram->open_banks = 0;
+  dram->precharged_banks = ALL_BANKS;
+  dram->in_progress_banks = 0;
+  dram->write_banks = 0;
+  dram->awaiting_access_banks = 0;
+  dram->closed_early_banks = 0;
+
+  for (int i = 0; i < NUM_BANKS; i++) {
+    dram->active_row[i] = 0;
+    dram->page_predictor[i] = PAGE_PREDICTOR_KEEP_OPEN;
+  }
+
+  // every bank timer starts out expired
+  for (int i = 0; i < NUM_TIMING_CONSTRAINTS; i++) {
+    dram->ready_banks[i] = ALL_BANKS;
+    for (int j = 0; j < NUM_BANKS; j++) {
+      dram->timing_ready_at[i][j] = 0;
+    }
+  }
+
   for (int i = 0; i < NUM_CONSECUTIVE_CMD_CONSTRAINTS; i++) {
-    dram->consecutive_cmd_timers[i] = 0;
+    dram->consecutive_cmd_ready_at[i] = 0;
+    dram->rank_ready_at[i] = 0;
+    for (int j = 0; j < NUM_BANK_GROUPS; j++) {
+      dram->bank_group_ready_at[i][j] = 0;
+    }
   }
+  dram->is_checking_bank_groups = false;
 
-  // zero out tfaw timers
   for (int i = 0; i < NUM_TFAW_COUNTERS; i++) {
-    dram->tFAW_timers[i] = 0;
+    dram->tFAW_ready_at[i] = 0;
   }
+
+  dram->cycle = 0;
+  dram->next_ready_at = UINT64_MAX;
+  dram->refresh_due_at = UINT64_MAX;
+  dram->refresh_credit = 0;
+  dram->refreshed_banks = 0;
+  dram->refresh_blocked = 0;
 }
 
 /*** function(s) ***/
-void dimm_create(DIMM_t **dimm, char *output_file_name) {
-  *dimm = malloc(sizeof(DIMM_t));
+void dimm_create(DIMM_t **dimm, char *output_file_name, CommandTraceFormat_t output_format, RefreshMode_t refresh_mode, char *timeline_file_name, bool is_attributing_stalls) {
+  *dimm = aligned_alloc(CACHE_LINE_BOUNDARY, sizeof(DIMM_t));
 
   if (*dimm == NULL) {
     fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
@@ -861,24 +1982,67 @@ void dimm_create(DIMM_t **dimm, char *output_file_name) {
   }
 
   // opening the file
-  (*dimm)->output_file = fopen(output_file_name, "w");
-  if ((*dimm)->output_file == NULL) {
-    fprintf(stderr, "%s:%d: fopen failed\n", __FILE__, __LINE__);
-    exit(EXIT_FAILURE);
-  }
+  (*dimm)->output_file = command_trace_open(output_file_name, output_format);
+  (*dimm)->refresh_mode = refresh_mode;
+  (*dimm)->timeline_file = timeline_file_name;
 
   for (int i = 0; i < NUM_CHANNELS; i++) {
     for (int j = 0; j < NUM_CHIPS_PER_CHANNEL; j++) {
       dram_init(&((*dimm)->channels[i].DDR5_chip[j]));
+      if (refresh_mode != REFRESH_OFF) {
+        (*dimm)->channels[i].DDR5_chip[j].refresh_due_at = refresh_interval(refresh_mode);
+        (*dimm)->channels[i].DDR5_chip[j].next_ready_at = refresh_interval(refresh_mode);
+      }
+    }
+
+    (*dimm)->channels[i].commands = command_trace_open_temporary();
+    (*dimm)->channels[i].is_idle = false;
+    (*dimm)->channels[i].is_draining_writes = false;
+    (*dimm)->channels[i].page_predictor = (PagePredictorStats_t){0};
+    memset(&(*dimm)->channels[i].latency, 0, sizeof(LatencyStats_t));
+    (*dimm)->channels[i].bandwidth = (BandwidthStats_t){.last_column_cmd = CMD_NONE};
+    (*dimm)->channels[i].timeline = NULL;
+    if (timeline_file_name != NULL) {
+      (*dimm)->channels[i].timeline = timeline_open(timeline_format_of(timeline_file_name), i, NUM_BANK_GROUPS, NUM_BANKS_PER_GROUP);
+    }
+    (*dimm)->channels[i].queue = NULL;
+    (*dimm)->channels[i].write_queue = NULL;
+    (*dimm)->channels[i].requests = (BankRequests_t){0};
+    (*dimm)->channels[i].stalls = NULL;
+    if (is_attributing_stalls) {
+      (*dimm)->channels[i].stalls = calloc(1, sizeof(StallStats_t));
+      if ((*dimm)->channels[i].stalls == NULL) {
+        fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+      }
     }
   }
 }
 
 void dimm_destroy(DIMM_t **dimm) {
   if (*dimm != NULL) {
+    // the channels ran independently, put their commands back in cycle order
+    CommandTrace_t *channel_commands[NUM_CHANNELS];
+    for (int i = 0; i < NUM_CHANNELS; i++) {
+      channel_commands[i] = (*dimm)->channels[i].commands;
+    }
+    command_trace_merge((*dimm)->output_file, channel_commands, NUM_CHANNELS);
+
+    if ((*dimm)->timeline_file != NULL) {
+      Timeline_t *channel_timelines[NUM_CHANNELS];
+      for (int i = 0; i < NUM_CHANNELS; i++) {
+        channel_timelines[i] = (*dimm)->channels[i].timeline;
+      }
+      timeline_merge((*dimm)->timeline_file, channel_timelines, NUM_CHANNELS);
+    }
+
     // closing the file
     if ((*dimm)->output_file) {
-      fclose((*dimm)->output_file);
+      command_trace_close((*dimm)->output_file);
+    }
+
+    for (int i = 0; i < NUM_CHANNELS; i++) {
+      free((*dimm)->channels[i].stalls);
     }
 
     free(*dimm);
@@ -886,8 +2050,40 @@ void dimm_destroy(DIMM_t **dimm) {
   }
 }
 
-void process_request(DIMM_t **dimm, Queue_t **q, uint64_t clock, uint8_t scheduling_algorithm) {
-  switch (scheduling_algorithm) {
+static inline __attribute__((always_inline)) void run_dimm_cycle(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t clock, uint8_t scheduling_algorithm, bool has_write_queue) {
+  /**
+   * @brief One DIMM cycle: the scheduler, then refresh, then the clock. Always inlined, so in
+   *        each scheduler kernel below the policy and the write queue are constants and the
+   *        switch and the write queue checks are compiled out.
+   */
+  if (!has_write_queue) {
+    write_q = NULL;
+  }
+
+  Channel_t *channel = &(*dimm)->channels[channel_id];
+  DRAM_t *dram = &channel->DDR5_chip[0];
+  channel->queue = *q;
+  channel->write_queue = (write_q != NULL) ? *write_q : NULL;
+  uint64_t queue_size = (*q)->size;
+  uint64_t write_queue_size = (write_q != NULL) ? (*write_q)->size : 0;
+
+  // with refresh on, the dram keeps time with the DIMM clock, also over the cycles nothing was
+  // queued for, so refresh deadlines run on while the channel is idle. Without refresh it only
+  // counts the cycles that process requests, as it always has
+  if ((*dimm)->refresh_mode != REFRESH_OFF && dimm_cycle_at(clock) > dram->cycle) {
+    advance_dram_clock(channel, dram, dimm_cycle_at(clock) - dram->cycle);
+  }
+  dram->is_checking_bank_groups = scheduling_algorithm >= LEVEL_4;
+  channel->is_idle = true;
+  if (channel->stalls != NULL) {
+    channel->stalls->issuing_request = NULL;
+    channel->stalls->is_closed_page = scheduling_algorithm == LEVEL_0;
+  }
+
+  uint64_t command_count = channel->commands->record_count;
+
+  // with refresh on, the DIMM is also clocked while nothing is queued, only to refresh
+  switch ((queue_size + write_queue_size > 0) ? scheduling_algorithm : NUM_SCHEDULING_ALGORITHMS) {
     case LEVEL_0:
       level_zero_algorithm(dimm, q, clock);
       break;
@@ -901,7 +2097,112 @@ void process_request(DIMM_t **dimm, Queue_t **q, uint64_t clock, uint8_t schedul
       bank_level_parallelism(dimm, q, clock);
       break;
 
+    case LEVEL_4:
+      fr_fcfs(dimm, channel_id, q, write_q, clock, false);
+      break;
+
+    case LEVEL_5:
+      fr_fcfs(dimm, channel_id, q, write_q, clock, true);
+      break;
+
     default:
       break;
   }
+
+  // refresh only takes the command bus when the scheduler left it free
+  refresh_scheduler(*dimm, channel_id, *q, (write_q != NULL) ? *write_q : NULL, clock, channel->commands->record_count == command_count);
+
+  if (channel->stalls != NULL) {
+    record_stalls(channel->stalls, &channel->DDR5_chip[0], *q, 1);
+    if (write_q != NULL) {
+      record_stalls(channel->stalls, &channel->DDR5_chip[0], *write_q, 1);
+    }
+  }
+
+  advance_dram_clock(channel, &channel->DDR5_chip[0], 1);
+
+  if ((*q)->size != queue_size || (write_q != NULL && (*write_q)->size != write_queue_size)) {
+    channel->is_idle = false;
+  }
+}
+
+// one kernel per policy level, with and without a separate write queue
+#define SCHEDULER_KERNEL(level, has_write_queue) \
+  static void scheduler_kernel_##level##_##has_write_queue(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t clock) { \
+    run_dimm_cycle(dimm, channel_id, q, write_q, clock, LEVEL_##level, has_write_queue); \
+  }
+
+SCHEDULER_KERNEL(0, false)
+SCHEDULER_KERNEL(0, true)
+SCHEDULER_KERNEL(1, false)
+SCHEDULER_KERNEL(1, true)
+SCHEDULER_KERNEL(2, false)
+SCHEDULER_KERNEL(2, true)
+SCHEDULER_KERNEL(3, false)
+SCHEDULER_KERNEL(3, true)
+SCHEDULER_KERNEL(4, false)
+SCHEDULER_KERNEL(4, true)
+SCHEDULER_KERNEL(5, false)
+SCHEDULER_KERNEL(5, true)
+
+static const SchedulerKernel_t scheduler_kernels[NUM_SCHEDULING_ALGORITHMS][2] = {
+  {scheduler_kernel_0_false, scheduler_kernel_0_true},
+  {scheduler_kernel_1_false, scheduler_kernel_1_true},
+  {scheduler_kernel_2_false, scheduler_kernel_2_true},
+  {scheduler_kernel_3_false, scheduler_kernel_3_true},
+  {scheduler_kernel_4_false, scheduler_kernel_4_true},
+  {scheduler_kernel_5_false, scheduler_kernel_5_true}
+};
+
+SchedulerKernel_t scheduler_kernel(uint8_t scheduling_algorithm, bool has_write_queue) {
+  return scheduler_kernels[scheduling_algorithm][has_write_queue];
+}
+
+void process_request(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t clock, uint8_t scheduling_algorithm) {
+  scheduler_kernels[scheduling_algorithm][write_q != NULL](dimm, channel_id, q, write_q, clock);
+}
+
+uint64_t skip_idle_cycles(DIMM_t **dimm, uint8_t channel_id, Queue_t **q, Queue_t **write_q, uint64_t max_cycles) {
+  /**
+   * @brief Fast-forwards the DIMM over the cycles following an idle cycle. While no request
+   *        changes state and no timer expires, every DIMM cycle behaves exactly like the
+   *        previous one, so they can be applied at once until the earliest timer expires.
+   *
+   * @param max_cycles  upper bound on the cycles to skip (e.g. until the next request arrives)
+   * @return uint64_t   number of DIMM cycles skipped
+   */
+  Channel_t *channel = &(*dimm)->channels[channel_id];
+  if (!channel->is_idle || (queue_is_empty(*q) && (write_q == NULL || queue_is_empty(*write_q)))) {
+    return 0;
+  }
+
+  DRAM_t *dram = &channel->DDR5_chip[0];
+
+  // no timer is running and nothing will arrive, skipping would never end
+  if (dram->next_ready_at == UINT64_MAX && max_cycles == UINT64_MAX) {
+    return 0;
+  }
+
+  uint64_t cycles = dram->next_ready_at - dram->cycle;
+  if (cycles > max_cycles) {
+    cycles = max_cycles;
+  }
+
+  // every skipped cycle leaves the requests waiting exactly as the last one did
+  if (channel->stalls != NULL) {
+    channel->stalls->issuing_request = NULL;
+    record_stalls(channel->stalls, dram, *q, cycles);
+    if (write_q != NULL) {
+      record_stalls(channel->stalls, dram, *write_q, cycles);
+    }
+  }
+
+  advance_dram_clock(channel, dram, cycles);
+
+  (*q)->cycle += cycles;  // age every queued request
+  if (write_q != NULL) {
+    (*write_q)->cycle += cycles;
+  }
+
+  return cycles;
 }
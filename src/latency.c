@@ -0,0 +1,129 @@
+/**
+ * @file  latency.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "latency.h"
+
+static const char *operation_names[NUM_OPERATIONS] = {"read", "write", "ifetch"};
+
+static int bucket_index(uint64_t latency) {
+  // small latencies get a bucket each, larger ones LATENCY_SUB_BUCKETS per power of two
+  if (latency < LATENCY_SUB_BUCKETS) {
+    return latency;
+  }
+
+  int msb = 63 - __builtin_clzll(latency);
+  int shift = msb - LATENCY_SUB_BUCKET_BITS;
+  return (shift + 1) * LATENCY_SUB_BUCKETS + (int)((latency >> shift) - LATENCY_SUB_BUCKETS);
+}
+
+static uint64_t bucket_upper_bound(int index) {
+  if (index < LATENCY_SUB_BUCKETS) {
+    return index;
+  }
+
+  int shift = index / LATENCY_SUB_BUCKETS - 1;
+  uint64_t lower = (uint64_t)(LATENCY_SUB_BUCKETS + index % LATENCY_SUB_BUCKETS) << shift;
+  return lower + ((uint64_t)1 << shift) - 1;
+}
+
+static void histogram_add(LatencyHistogram_t *histogram, uint64_t latency, uint64_t queued) {
+  histogram->buckets[bucket_index(latency)]++;
+  histogram->count++;
+  histogram->total += latency;
+  histogram->queued_total += queued;
+  if (latency > histogram->max) {
+    histogram->max = latency;
+  }
+}
+
+static void histogram_merge(LatencyHistogram_t *into, LatencyHistogram_t *from) {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    into->buckets[i] += from->buckets[i];
+  }
+  into->count += from->count;
+  into->total += from->total;
+  into->queued_total += from->queued_total;
+  if (from->max > into->max) {
+    into->max = from->max;
+  }
+}
+
+void latency_record(LatencyStats_t *stats, MemoryRequest_t *request, uint64_t dequeue_cycle) {
+  uint64_t latency = request->data_complete_cycle - request->time;
+  uint64_t queued = request->first_command_cycle - request->time;
+
+  histogram_add(&stats->operations[request->operation], latency, queued);
+  histogram_add(&stats->cores[request->core], latency, queued);
+  stats->retire_total += dequeue_cycle - request->data_complete_cycle;
+}
+
+void latency_merge(LatencyStats_t *into, LatencyStats_t *from) {
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    histogram_merge(&into->operations[i], &from->operations[i]);
+  }
+  for (int i = 0; i < NUM_CORES; i++) {
+    histogram_merge(&into->cores[i], &from->cores[i]);
+  }
+  into->retire_total += from->retire_total;
+}
+
+uint64_t latency_percentile(LatencyHistogram_t *histogram, double percentile) {
+  if (histogram->count == 0) {
+    return 0;
+  }
+
+  // rank of the percentile, rounded up so p100 is the last request
+  uint64_t rank = (uint64_t)(percentile / 100.0 * histogram->count);
+  if (rank < histogram->count && rank * 100.0 < percentile * histogram->count) {
+    rank++;
+  }
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      uint64_t upper_bound = bucket_upper_bound(i);
+      return (upper_bound < histogram->max) ? upper_bound : histogram->max;
+    }
+  }
+
+  return histogram->max;
+}
+
+static void print_row(FILE *file, const char *name, LatencyHistogram_t *histogram) {
+  if (histogram->count == 0) {
+    return;
+  }
+
+  fprintf(file, "%-8s %12" PRIu64 " %10.1f %10.1f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n", name, histogram->count,
+          (double)histogram->total / histogram->count, (double)histogram->queued_total / histogram->count,
+          latency_percentile(histogram, 50), latency_percentile(histogram, 95), latency_percentile(histogram, 99), histogram->max);
+}
+
+void latency_print(FILE *file, LatencyStats_t *stats) {
+  uint64_t count = 0;
+  char name[16];
+
+  fprintf(file, "--- Request Latency (CPU clock cycles, arrival to end of data) ---\n");
+  fprintf(file, "%-8s %12s %10s %10s %8s %8s %8s %8s\n", "", "requests", "mean", "queued", "p50", "p95", "p99", "max");
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    print_row(file, operation_names[i], &stats->operations[i]);
+    count += stats->operations[i].count;
+  }
+  for (int i = 0; i < NUM_CORES; i++) {
+    snprintf(name, sizeof(name), "core %d", i);
+    print_row(file, name, &stats->cores[i]);
+  }
+
+  if (count > 0) {
+    fprintf(file, "Mean cycles from end of data to dequeue: %.1f\n", (double)stats->retire_total / count);
+  }
+  fprintf(file, "-----------------------------\n");
+}
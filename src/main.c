@@ -21,100 +21,106 @@
 #include <string.h>
 #include <time.h>
 #include "common.h"
-#include "dimm.h"
-#include "memory_request.h"
-#include "parser.h"
 #include "queue.h"
+#include "simulation.h"
 
 /*** macro(s), enum(s), and struct(s) ***/
-#define MAX_QUEUE_SIZE 16
+#define DEFAULT_QUEUE_SIZE 16
 #define DEFAULT_INPUT_FILE "trace.txt"
 #define DEFAULT_OUTPUT_FILE "dram.txt"
 
 /*** function prototype(s) ***/
-void process_args(int argc, char *argv[], char **input_file, char **output_file, int *scheduling_policy);
-void out_of_order(Queue_t *global_queue, MemoryRequest_t *current_request);
-void advance_clock(uint64_t *clock_cycle, Queue_t *global_queue, Parser_t *parser);
+void process_args(int argc, char *argv[], char **input_file, char **output_file, int *scheduling_policy, bool *fast_forward, uint64_t *queue_size, CommandTraceFormat_t *output_format, RefreshMode_t *refresh_mode, uint64_t *write_queue_size, char **timeline_file, bool *attribute_stalls, AddressMapping_t *address_mapping, char **profile_file);
+void print_bandwidth(SimulationResult_t *result);
+void print_stalls(SimulationResult_t *result);
 
 /*** function(s) ***/
 int main(int argc, char *argv[]) {
-  clock_t begin_execution = clock();
+  struct timespec begin_execution, end_execution;
+  clock_gettime(CLOCK_MONOTONIC, &begin_execution);  // wall-clock time, the channels run on several threads
   char *input_file_name, *output_file_name;
   int scheduling_policy = 0;  // default is level 0
-  process_args(argc, argv, &input_file_name, &output_file_name, &scheduling_policy);
+  bool fast_forward = false;  // skip DIMM cycles where every request is waiting on a timer
+  uint64_t queue_size = DEFAULT_QUEUE_SIZE;
+  CommandTraceFormat_t output_format = TEXT_FORMAT;
+  RefreshMode_t refresh_mode = REFRESH_OFF;
+  uint64_t write_queue_size = 0;  // default is one queue for reads and writes
+  char *timeline_file = NULL;     // default is no timeline
+  bool attribute_stalls = false;
+  AddressMapping_t address_mapping = MAPPING_DEFAULT;
+  char *profile_file = NULL;      // default is the built-in DDR5-4800 profile
+  process_args(argc, argv, &input_file_name, &output_file_name, &scheduling_policy, &fast_forward, &queue_size, &output_format, &refresh_mode, &write_queue_size, &timeline_file, &attribute_stalls, &address_mapping, &profile_file);
+  set_address_mapping(address_mapping);
+  if (profile_file != NULL) {
+    timing_profile_load(profile_file);
+  }
 
   printf("--- Simulation Parameters ---\n");
   printf("Scheduling Policy Level: %d\n", scheduling_policy);
   printf("Input File: %s\n", input_file_name);
-  printf("Output File: %s\n", output_file_name);
+  printf("Output File: %s (%s)\n", output_file_name, output_format == BINARY_FORMAT ? "binary" : "text");
+  printf("Queue Size: %" PRIu64 "\n", queue_size);
+  if (write_queue_size > 0) {
+    printf("Write Queue Size: %" PRIu64 "\n", write_queue_size);
+  }
+  if (timeline_file != NULL) {
+    printf("Timeline File: %s (%s)\n", timeline_file, timeline_format_of(timeline_file) == TIMELINE_JSON ? "json" : "csv");
+  }
+  if (profile_file != NULL) {
+    printf("Timing Profile: %s (%" PRIu32 " MT/s, CL%" PRIu32 ")\n", timing_profile.name, timing_profile.data_rate,
+           timing_profile.timing_attribute[tCL]);
+  }
+  if (address_mapping != MAPPING_DEFAULT) {
+    printf("Address Mapping: %s\n", address_mapping_name(address_mapping));
+  }
+  printf("Fast-Forward: %s\n", fast_forward ? "on" : "off");
+  printf("Refresh: %s\n", refresh_mode == REFRESH_OFF ? "off" : refresh_mode == REFRESH_ALL_BANK ? "all-bank" : "same-bank");
   printf("-----------------------------\n");
 
-  Parser_t *parser = parser_init(input_file_name);
-  DIMM_t *PC5_38400 = NULL;
-  Queue_t *global_queue = NULL;
-
-  dimm_create(&PC5_38400, output_file_name);    // create DIMM
-  queue_create(&global_queue, MAX_QUEUE_SIZE);  // create queue of size 16
-
-  uint64_t clock_cycle = 0;  // tracking the clock cycle (CPU clock). DIMM clock cycle is 1/2.
-  MemoryRequest_t *current_request = NULL;
-
-  while (true) {
-    if (current_request == NULL) {
-      current_request = parser_next_request(parser, clock_cycle);  // only returns the request if the current cycle >= request's time
-    }
-
-    // DIMM clock cycle - only process request if there is one in the queue
-    if (clock_cycle % 2 == 0 && !queue_is_empty(global_queue)) {
-      process_request(&PC5_38400, &global_queue, clock_cycle, scheduling_policy);
-      increment_aging_in_queue(global_queue);
-    }
-
-    // CPU clock cycle - enqueue if there is a request and queue is not full
-    if (current_request != NULL && !queue_is_full(global_queue)) {
-      if (scheduling_policy == LEVEL_3) {
-        out_of_order(global_queue, current_request);
-
-      } else {
-        enqueue(&global_queue, *current_request);
-      }
-      log_memory_request("Enqueued:", current_request, clock_cycle);
-      free(current_request);
-      current_request = NULL;
-    }
+  SimulationConfig_t config = {
+    .input_file = input_file_name,
+    .output_file = output_file_name,
+    .scheduling_policy = scheduling_policy,
+    .queue_size = queue_size,
+    .fast_forward = fast_forward,
+    .output_format = output_format,
+    .refresh_mode = refresh_mode,
+    .write_queue_size = write_queue_size,
+    .timeline_file = timeline_file,
+    .attribute_stalls = attribute_stalls
+  };
+  SimulationResult_t result;
 
-    if (parser->status == END_OF_FILE && queue_is_empty(global_queue)) {
-      LOG("END OF SIMULATION\n");
-      break;
-    }
+  simulate(&config, &result);
 
-    advance_clock(&clock_cycle, global_queue, parser);
+  clock_gettime(CLOCK_MONOTONIC, &end_execution);
+  printf("Total Clock Cycles: %" PRIu64 "\n", result.total_cycles);
+  if (write_queue_size > 0) {
+    printf("Forwarded Reads: %" PRIu64 "\n", result.forwarded_reads);
+    printf("Merged Writes: %" PRIu64 "\n", result.merged_writes);
   }
-
-  parser_destroy(parser);
-  queue_destroy(&global_queue);
-  dimm_destroy(&PC5_38400);
-  clock_t end_execution = clock();
-  printf("Total Clock Cycles: %" PRIu64 "\n", clock_cycle);
-  printf("Program Execution Time: %lf seconds\n", (double)(end_execution - begin_execution) / CLOCKS_PER_SEC);
-  return 0;
-}
-
-void advance_clock(uint64_t *clock_cycle, Queue_t *global_queue, Parser_t *parser) {
-  if (queue_is_empty(global_queue) && parser->next_request->time > *clock_cycle) {
-    LOG("No requests are processing. Advancing clock to next request time (%" PRIu64 ")\n", parser->next_request->time);
-    *clock_cycle = parser->next_request->time;
-  } else {
-    *clock_cycle += 1;
+  if (scheduling_policy == LEVEL_5) {
+    PagePredictorStats_t *page_predictor = &result.page_predictor;
+    printf("Rows Kept Open: %" PRIu64 " (%" PRIu64 " hits, %" PRIu64 " misses)\n", page_predictor->open_hits + page_predictor->open_misses,
+           page_predictor->open_hits, page_predictor->open_misses);
+    printf("Rows Closed Early: %" PRIu64 " (%" PRIu64 " hits, %" PRIu64 " misses)\n", page_predictor->close_hits + page_predictor->close_misses,
+           page_predictor->close_hits, page_predictor->close_misses);
+  }
+  latency_print(stdout, &result.latency);
+  print_bandwidth(&result);
+  if (attribute_stalls) {
+    print_stalls(&result);
   }
+  printf("Program Execution Time: %lf seconds\n", (end_execution.tv_sec - begin_execution.tv_sec) + (end_execution.tv_nsec - begin_execution.tv_nsec) / 1e9);
+  return 0;
 }
 
-void process_args(int argc, char *argv[], char **input_file, char **output_file, int *scheduling_policy) {
+void process_args(int argc, char *argv[], char **input_file, char **output_file, int *scheduling_policy, bool *fast_forward, uint64_t *queue_size, CommandTraceFormat_t *output_format, RefreshMode_t *refresh_mode, uint64_t *write_queue_size, char **timeline_file, bool *attribute_stalls, AddressMapping_t *address_mapping, char **profile_file) {
   int opt;
   *input_file = DEFAULT_INPUT_FILE;
   *output_file = DEFAULT_OUTPUT_FILE;
 
-  while ((opt = getopt(argc, argv, "i:o:s:h")) != -1) {
+  while ((opt = getopt(argc, argv, "i:o:s:q:r:w:t:M:p:afbh")) != -1) {
     switch (opt) {
       case 'i':  // Input file
         *input_file = optarg;
@@ -124,76 +130,132 @@ void process_args(int argc, char *argv[], char **input_file, char **output_file,
         break;
       case 's':  // Scheduling policy
         *scheduling_policy = atoi(optarg);
-        if (*scheduling_policy < 0 || *scheduling_policy > 3) {
-          fprintf(stderr, "Invalid scheduling policy: %d. Must be between 0 and 3.\n", *scheduling_policy);
+        if (*scheduling_policy < 0 || *scheduling_policy > 5) {
+          fprintf(stderr, "Invalid scheduling policy: %d. Must be between 0 and 5.\n", *scheduling_policy);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'q':  // Queue size
+        *queue_size = strtoull(optarg, NULL, 10);
+        if (*queue_size < 1 || *queue_size > QUEUE_MAX_CAPACITY) {
+          fprintf(stderr, "Invalid queue size: %s. Must be between 1 and %d.\n", optarg, QUEUE_MAX_CAPACITY);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'r':  // Refresh mode
+        *refresh_mode = atoi(optarg);
+        if (*refresh_mode < REFRESH_OFF || *refresh_mode > REFRESH_SAME_BANK) {
+          fprintf(stderr, "Invalid refresh mode: %s. Must be between 0 and 2.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'w':  // Separate write queue size
+        *write_queue_size = strtoull(optarg, NULL, 10);
+        if (*write_queue_size < 1 || *write_queue_size > QUEUE_MAX_CAPACITY) {
+          fprintf(stderr, "Invalid write queue size: %s. Must be between 1 and %d.\n", optarg, QUEUE_MAX_CAPACITY);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 't':  // Bank state timeline
+        *timeline_file = optarg;
+        break;
+      case 'M':  // Address mapping
+        if (!address_mapping_from_name(optarg, address_mapping)) {
+          fprintf(stderr, "Invalid address mapping: %s. Must be default, xor, row or line.\n", optarg);
           exit(EXIT_FAILURE);
         }
         break;
+      case 'p':  // Timing profile
+        *profile_file = optarg;
+        break;
+      case 'a':  // Attribute stalled cycles to their cause
+        *attribute_stalls = true;
+        break;
+      case 'f':  // Fast-forward idle DIMM cycles
+        *fast_forward = true;
+        break;
+      case 'b':  // Binary command trace
+        *output_format = BINARY_FORMAT;
+        break;
       case 'h':
       case '?':
-        fprintf(stderr, "Usage: %s [-i input_file] [-o output_file] [-s scheduling_policy]\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-i input_file] [-o output_file] [-s scheduling_policy] [-q queue_size] [-r refresh_mode] [-w write_queue_size] [-t timeline_file] [-M address_mapping] [-p timing_profile] [-a] [-f] [-b]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
   }
+
+  // draining writes is part of the FR-FCFS scheduler
+  if (*write_queue_size > 0 && *scheduling_policy < LEVEL_4) {
+    fprintf(stderr, "A separate write queue requires scheduling policy 4 or 5.\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
-void out_of_order(Queue_t *global_queue, MemoryRequest_t *current_request) {
-  check_requests_age(global_queue);
+void print_bandwidth(SimulationResult_t *result) {
+  BandwidthStats_t *stats = &result->bandwidth;
+  uint64_t *commands = stats->commands;
+  uint64_t requests = stats->row_hits + stats->row_misses + stats->row_empties;
+  // every channel is counted for the whole run
+  double channel_cycles = (double)result->total_cycles * NUM_CHANNELS;
+  double seconds = result->total_cycles / (CPU_CLOCK_GHZ * 1e9);
+  double bandwidth = 0;
 
-  bool inserted = false;  // flag so we dont insert it twice
+  if (result->total_cycles == 0) {
+    channel_cycles = 1;
+  }
+  if (seconds > 0) {
+    bandwidth = (commands[CMD_RD0] + commands[CMD_WR0]) * CACHE_LINE_SIZE / seconds / 1e9;
+  }
 
-  // this if else is for reads>writes when valid
-  if (current_request->operation == DATA_WRITE) {
-    for (int i = 0; i < global_queue->size && !inserted; i++) {
-      MemoryRequest_t *read_request = queue_peek_at(global_queue, i);
-      if (read_request->operation != DATA_WRITE && read_request->bank_group == current_request->bank_group &&
-          read_request->bank == current_request->bank && (read_request->row != current_request->row)) {
-        // we put DATA_WRITE after the DATA_READ or IFETCH
-        queue_insert_at(&global_queue, i + 1, *current_request);
-        inserted = true;
-        break;
-      }
-    }
-  } else {
-    for (int i = 0; i < global_queue->size && !inserted; i++) {
-      MemoryRequest_t *write_request = queue_peek_at(global_queue, i);
-      if (write_request->operation == DATA_WRITE && write_request->bank_group == current_request->bank_group &&
-          write_request->bank == current_request->bank && (write_request->row != current_request->row)) {
-        // we put the DATA_READ or IFETCH before the DATA_WRITE
-        queue_insert_at(&global_queue, i, *current_request);
-        inserted = true;
-        break;
+  printf("--- Bandwidth ---\n");
+  printf("Commands: %" PRIu64 " ACT, %" PRIu64 " RD, %" PRIu64 " WR, %" PRIu64 " PRE, %" PRIu64 " REF, %" PRIu64 " REFsb\n",
+         commands[CMD_ACT0], commands[CMD_RD0], commands[CMD_WR0], commands[CMD_PRE], commands[CMD_REF], commands[CMD_REFSB]);
+  printf("Data Bus Busy: %" PRIu64 " cycles (%.1f%%)\n", stats->data_bus_cycles, 100.0 * stats->data_bus_cycles / channel_cycles);
+  printf("Row Hits: %" PRIu64 ", Misses: %" PRIu64 ", Empties: %" PRIu64 " (%.1f%% hits)\n", stats->row_hits, stats->row_misses,
+         stats->row_empties, requests > 0 ? 100.0 * stats->row_hits / requests : 0.0);
+  printf("Bank Active Time: %.1f%%\n", 100.0 * stats->bank_active_cycles / (channel_cycles * NUM_BANKS));
+  printf("Turnarounds: %" PRIu64 " RD to WR, %" PRIu64 " WR to RD\n", stats->read_to_write, stats->write_to_read);
+  printf("Achieved Bandwidth: %.2f GB/s of %.1f GB/s peak (%.1f%%)\n", bandwidth, PEAK_BANDWIDTH_GBPS, 100.0 * bandwidth / PEAK_BANDWIDTH_GBPS);
+  printf("-----------------------------\n");
+}
+
+void print_stalls(SimulationResult_t *result) {
+  uint64_t cause_cycles[NUM_STALL_CAUSES] = {0};
+  uint64_t total = 0;
+
+  for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+    for (int bank = 0; bank < NUM_BANKS; bank++) {
+      for (int cause = 0; cause < NUM_STALL_CAUSES; cause++) {
+        cause_cycles[cause] += result->stall_cycles[channel][bank][cause];
+        total += result->stall_cycles[channel][bank][cause];
       }
     }
   }
-  // if read > write is not valid, we want to prioritize hits.
-  // put the read after write so we dont read stale data
-  if (!inserted && current_request->operation != DATA_WRITE) {
-    for (int i = 0; i < global_queue->size && !inserted; i++) {
-      MemoryRequest_t *write_request = queue_peek_at(global_queue, i);
-      if (write_request->operation == DATA_WRITE && write_request->bank_group == current_request->bank_group &&
-          write_request->bank == current_request->bank && (write_request->row == current_request->row)) {
-        queue_insert_at(&global_queue, i + 1, *current_request);
-        inserted = true;
-      }
+
+  printf("--- Stalls (CPU clock cycles requests waited) ---\n");
+  for (int cause = 0; cause < NUM_STALL_CAUSES; cause++) {
+    if (cause_cycles[cause] > 0) {
+      printf("%-12s %14" PRIu64 " %6.1f%%\n", stall_cause_names[cause], cause_cycles[cause], 100.0 * cause_cycles[cause] / total);
     }
   }
-  // if read > write is not valid, we want to prioritize hits.
-  // put the read next to the other read
-  if (!inserted && current_request->operation != DATA_WRITE) {
-    for (int i = 0; i < global_queue->size && !inserted; i++) {
-      MemoryRequest_t *read_request = queue_peek_at(global_queue, i);
-      if (read_request->operation != DATA_WRITE && read_request->bank_group == current_request->bank_group &&
-          read_request->bank == current_request->bank && (read_request->row == current_request->row)) {
-        queue_insert_at(&global_queue, i + 1, *current_request);
-        inserted = true;
-        break;
+
+  // each bank of each channel with the cause it waited on most
+  for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+    for (int bank = 0; bank < NUM_BANKS; bank++) {
+      uint64_t *bank_cycles = result->stall_cycles[channel][bank];
+      uint64_t bank_total = 0;
+      int top_cause = 0;
+      for (int cause = 0; cause < NUM_STALL_CAUSES; cause++) {
+        bank_total += bank_cycles[cause];
+        if (bank_cycles[cause] > bank_cycles[top_cause]) {
+          top_cause = cause;
+        }
+      }
+      if (bank_total > 0) {
+        printf("CH%d BG%d B%d %14" PRIu64 " %6.1f%%  (mostly %s, %.1f%%)\n", channel, bank / NUM_BANKS_PER_GROUP, bank % NUM_BANKS_PER_GROUP,
+               bank_total, 100.0 * bank_total / total, stall_cause_names[top_cause], 100.0 * bank_cycles[top_cause] / bank_total);
       }
     }
   }
-
-  // flag not up we do it normally
-  if (!inserted) {
-    enqueue(&global_queue, *current_request);
-  }
+  printf("-----------------------------\n");
 }
@@ -7,14 +7,78 @@
 
 #include "memory_request.h"
 
+// bit position of each field; the field widths are the same in every mapping
+typedef struct AddressLayout {
+  uint8_t channel;
+  uint8_t bank_group;
+  uint8_t bank;
+  uint8_t column_high;
+  uint8_t row;
+  bool is_bank_hashed;  // bank group and bank are XORed with the low row bits
+} AddressLayout_t;
+
+static const AddressLayout_t layouts[NUM_ADDRESS_MAPPINGS] = {
+  [MAPPING_DEFAULT] = {.channel = 6, .bank_group = 7, .bank = 10, .column_high = 12, .row = 18},
+  [MAPPING_XOR] = {.channel = 6, .bank_group = 7, .bank = 10, .column_high = 12, .row = 18, .is_bank_hashed = true},
+  [MAPPING_ROW] = {.channel = 12, .bank_group = 13, .bank = 16, .column_high = 6, .row = 18},
+  [MAPPING_CACHE_LINE] = {.channel = 11, .bank_group = 6, .bank = 9, .column_high = 12, .row = 18},
+};
+
+static const char *mapping_names[NUM_ADDRESS_MAPPINGS] = {"default", "xor", "row", "line"};
+
+static const AddressLayout_t *layout = &layouts[MAPPING_DEFAULT];
+
+void set_address_mapping(AddressMapping_t mapping) {
+  layout = &layouts[mapping];
+}
+
+bool address_mapping_from_name(const char *name, AddressMapping_t *mapping) {
+  for (int i = 0; i < NUM_ADDRESS_MAPPINGS; i++) {
+    if (strcmp(name, mapping_names[i]) == 0) {
+      *mapping = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *address_mapping_name(AddressMapping_t mapping) {
+  return mapping_names[mapping];
+}
+
 static void map_address(MemoryRequest_t *memory_request, uint64_t address) {
   memory_request->byte_select = address & ((1 << 2) - 1);
   memory_request->column_low = (address >> 2) & ((1 << 4) - 1);
-  memory_request->channel = (address >> 6) & 1;
-  memory_request->bank_group = (address >> 7) & ((1 << 3) - 1);
-  memory_request->bank = (address >> 10) & ((1 << 2) - 1);
-  memory_request->column_high = (address >> 12) & ((1 << 6) - 1);
-  memory_request->row = (address >> 18) & ((1 << 16) - 1);
+  memory_request->channel = (address >> layout->channel) & 1;
+  memory_request->bank_group = (address >> layout->bank_group) & ((1 << 3) - 1);
+  memory_request->bank = (address >> layout->bank) & ((1 << 2) - 1);
+  memory_request->column_high = (address >> layout->column_high) & ((1 << 6) - 1);
+  memory_request->row = (address >> layout->row) & ((1 << 16) - 1);
+
+  // permuting the banks by the row spreads strides that would hit one bank group over all of them
+  if (layout->is_bank_hashed) {
+    memory_request->bank_group ^= memory_request->row & ((1 << 3) - 1);
+    memory_request->bank ^= (memory_request->row >> 3) & ((1 << 2) - 1);
+  }
+}
+
+uint64_t get_address(MemoryRequest_t *memory_request) {
+  // inverse of map_address
+  uint64_t bank_group = memory_request->bank_group;
+  uint64_t bank = memory_request->bank;
+
+  if (layout->is_bank_hashed) {
+    bank_group ^= memory_request->row & ((1 << 3) - 1);
+    bank ^= (memory_request->row >> 3) & ((1 << 2) - 1);
+  }
+
+  return (uint64_t)memory_request->byte_select |
+         ((uint64_t)memory_request->column_low << 2) |
+         ((uint64_t)memory_request->channel << layout->channel) |
+         (bank_group << layout->bank_group) |
+         (bank << layout->bank) |
+         ((uint64_t)memory_request->column_high << layout->column_high) |
+         ((uint64_t)memory_request->row << layout->row);
 }
 
 void memory_request_init(MemoryRequest_t *memory_request, uint64_t time, uint8_t core, uint8_t operation, uint64_t address) {
@@ -23,10 +87,17 @@ void memory_request_init(MemoryRequest_t *memory_request, uint64_t time, uint8_t
   memory_request->operation = operation;
   map_address(memory_request, address);
   memory_request->state = PENDING;
-  memory_request->aging = 0;
+  memory_request->enqueue_cycle = 0;
+  memory_request->first_command_cycle = CYCLE_UNSET;
+  memory_request->data_complete_cycle = CYCLE_UNSET;
+  memory_request->older_reads = 0;
   memory_request->is_finished = false;
 }
 
+bool is_same_cache_line(MemoryRequest_t *memory_request, MemoryRequest_t *other) {
+  return get_address(memory_request) / CACHE_LINE_SIZE == get_address(other) / CACHE_LINE_SIZE;
+}
+
 uint16_t get_column(MemoryRequest_t *memory_request) {
   return ((memory_request->column_high << 4) | memory_request->column_low);
 }
@@ -5,12 +5,22 @@
  *
  */
 
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "parser.h"
 
 /** helper function(s) **/
-FILE *open_file(char *file_name, char *mode);
+void map_file(Parser_t *parser, char *file_name);
+void detect_format(Parser_t *parser, char *file_name);
 void parser_next_line(Parser_t *parser);
-MemoryRequest_t parse_line(char *line);
+void parser_next_record(Parser_t *parser);
+void parser_next_fed(Parser_t *parser);
+void publish_block(ChannelFeed_t *channel);
+void create_request(MemoryRequest_t *memory_request, uint64_t time, uint64_t core, uint64_t operation, uint64_t address);
+void *feed_trace(void *arg);
 
 Parser_t *parser_init(char *input_file) {
   Parser_t *parser = malloc(sizeof(Parser_t));
@@ -20,17 +30,142 @@ Parser_t *parser_init(char *input_file) {
     exit(EXIT_FAILURE);
   }
 
-  parser->file = open_file(input_file, "r");
-  parser->next_request = NULL;
+  map_file(parser, input_file);
+  detect_format(parser, input_file);
+  parser->feed = NULL;
+  parser->block = NULL;
+  parser->next_request = &parser->requests[0];
 
   parser_next_line(parser);
 
   return parser;
 }
 
+Parser_t *parser_init_feed(TraceFeed_t *feed, int channel) {
+  Parser_t *parser = malloc(sizeof(Parser_t));
+
+  if (parser == NULL) {
+    perror("Error allocating memory for parser");
+    exit(EXIT_FAILURE);
+  }
+
+  // nothing is mapped, the feed's parser reads the file
+  parser->data = NULL;
+  parser->size = 0;
+  parser->position = 0;
+  parser->is_binary = false;
+  parser->feed = &feed->channels[channel];
+  parser->block = NULL;
+  parser->block_position = 0;
+  parser->next_request = &parser->requests[0];
+
+  parser_next_line(parser);
+
+  return parser;
+}
+
+TraceFeed_t *trace_feed_create(char *input_file, int num_channels) {
+  TraceFeed_t *feed = malloc(sizeof(TraceFeed_t));
+  if (feed == NULL) {
+    perror("Error allocating memory for trace feed");
+    exit(EXIT_FAILURE);
+  }
+
+  feed->channels = malloc(num_channels * sizeof(ChannelFeed_t));
+  if (feed->channels == NULL) {
+    perror("Error allocating memory for trace feed");
+    exit(EXIT_FAILURE);
+  }
+
+  feed->num_channels = num_channels;
+  for (int i = 0; i < num_channels; i++) {
+    ChannelFeed_t *channel = &feed->channels[i];
+    channel->first = 0;
+    channel->filled = 0;
+    channel->is_done = false;
+    channel->filling = NULL;
+    pthread_mutex_init(&channel->lock, NULL);
+    pthread_cond_init(&channel->changed, NULL);
+  }
+
+  // the file is opened here, so a missing file is reported before any thread starts
+  feed->parser = parser_init(input_file);
+  if (pthread_create(&feed->thread, NULL, feed_trace, feed) != 0) {
+    fprintf(stderr, "Error: Could not start the thread that parses %s.\n", input_file);
+    exit(EXIT_FAILURE);
+  }
+
+  return feed;
+}
+
+void trace_feed_destroy(TraceFeed_t *feed) {
+  if (feed == NULL) {
+    return;
+  }
+
+  pthread_join(feed->thread, NULL);
+  parser_destroy(feed->parser);
+  for (int i = 0; i < feed->num_channels; i++) {
+    pthread_mutex_destroy(&feed->channels[i].lock);
+    pthread_cond_destroy(&feed->channels[i].changed);
+  }
+  free(feed->channels);
+  free(feed);
+}
+
+void publish_block(ChannelFeed_t *channel) {
+  pthread_mutex_lock(&channel->lock);
+  channel->filled++;
+  pthread_cond_broadcast(&channel->changed);
+  pthread_mutex_unlock(&channel->lock);
+  channel->filling = NULL;
+}
+
+void *feed_trace(void *arg) {
+  TraceFeed_t *feed = arg;
+  MemoryRequest_t *request;
+
+  // every request is due at the last possible cycle, so the parser hands them all out in order
+  while ((request = parser_next_request(feed->parser, UINT64_MAX)) != NULL) {
+    ChannelFeed_t *channel = &feed->channels[request->channel];
+
+    if (channel->filling == NULL) {
+      // the block after the filled ones is free once the channel has given back the oldest
+      pthread_mutex_lock(&channel->lock);
+      while (channel->filled == FEED_NUM_BLOCKS) {
+        pthread_cond_wait(&channel->changed, &channel->lock);
+      }
+      channel->filling = &channel->blocks[(channel->first + channel->filled) % FEED_NUM_BLOCKS];
+      pthread_mutex_unlock(&channel->lock);
+      channel->filling->count = 0;
+    }
+
+    channel->filling->requests[channel->filling->count++] = *request;
+    if (channel->filling->count == FEED_BLOCK_SIZE) {
+      publish_block(channel);
+    }
+  }
+
+  for (int i = 0; i < feed->num_channels; i++) {
+    ChannelFeed_t *channel = &feed->channels[i];
+    if (channel->filling != NULL) {
+      publish_block(channel);
+    }
+
+    pthread_mutex_lock(&channel->lock);
+    channel->is_done = true;
+    pthread_cond_broadcast(&channel->changed);
+    pthread_mutex_unlock(&channel->lock);
+  }
+
+  return NULL;
+}
+
 void parser_destroy(Parser_t *parser) {
   if (parser != NULL) {
-    fclose(parser->file);
+    if (parser->size > 0) {
+      munmap(parser->data, parser->size);
+    }
     free(parser);
   }
 }
@@ -38,6 +173,9 @@ void parser_destroy(Parser_t *parser) {
 MemoryRequest_t *parser_next_request(Parser_t *parser, uint64_t cycle) {
   if (parser->status == OK && parser->next_request->time <= cycle) {
     MemoryRequest_t *request = parser->next_request;
+
+    // parse ahead into the other slot so the returned request is left untouched
+    parser->next_request = (request == &parser->requests[0]) ? &parser->requests[1] : &parser->requests[0];
     parser_next_line(parser);
     return request;
   }
@@ -45,86 +183,263 @@ MemoryRequest_t *parser_next_request(Parser_t *parser, uint64_t cycle) {
   return NULL;
 }
 
-FILE *open_file(char *file_name, char *mode) {
-  FILE *file = fopen(file_name, mode);
-  if (file == NULL) {
+void map_file(Parser_t *parser, char *file_name) {
+  int fd = open(file_name, O_RDONLY);
+  struct stat file_stat;
+
+  if (fd == -1 || fstat(fd, &file_stat) == -1) {
     perror("Error opening file");
     exit(EXIT_FAILURE);
   }
 
-  return file;
+  parser->size = file_stat.st_size;
+  parser->data = NULL;
+
+  // mmap cannot map an empty file
+  if (parser->size > 0) {
+    parser->data = mmap(NULL, parser->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (parser->data == MAP_FAILED) {
+      perror("Error mapping file");
+      exit(EXIT_FAILURE);
+    }
+
+    madvise(parser->data, parser->size, MADV_SEQUENTIAL);
+  }
+
+  close(fd);
+}
+
+void detect_format(Parser_t *parser, char *file_name) {
+  TraceHeader_t header;
+  parser->is_binary = false;
+  parser->position = 0;
+
+  if (parser->size < sizeof(header) || memcmp(parser->data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+    return;
+  }
+
+  memcpy(&header, parser->data, sizeof(header));
+
+  if (header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord_t)) {
+    fprintf(stderr, "Error: %s has unsupported binary trace version %u (record size %u)\n", file_name, header.version, header.record_size);
+    exit(EXIT_FAILURE);
+  }
+
+  if (parser->size != sizeof(header) + header.record_count * sizeof(TraceRecord_t)) {
+    fprintf(stderr, "Error: %s should hold %" PRIu64 " requests but its size does not match (truncated trace?)\n", file_name, header.record_count);
+    exit(EXIT_FAILURE);
+  }
+
+  parser->is_binary = true;
+  parser->position = sizeof(header);
+}
+
+void parser_next_record(Parser_t *parser) {
+  while (parser->position < parser->size) {
+    // records are not necessarily aligned in the mapping
+    TraceRecord_t record;
+    memcpy(&record, parser->data + parser->position, sizeof(record));
+    parser->position += sizeof(record);
+
+    create_request(parser->next_request, record.time, record.core, record.operation, record.address);
+    parser->status = OK;
+    return;
+  }
+
+  parser->status = END_OF_FILE;
+}
+
+void parser_next_fed(Parser_t *parser) {
+  ChannelFeed_t *channel = parser->feed;
+
+  pthread_mutex_lock(&channel->lock);
+  if (parser->block != NULL && parser->block_position == parser->block->count) {
+    // hand the read block back to the feed
+    channel->first = (channel->first + 1) % FEED_NUM_BLOCKS;
+    channel->filled--;
+    pthread_cond_broadcast(&channel->changed);
+    parser->block = NULL;
+  }
+  if (parser->block == NULL) {
+    while (channel->filled == 0 && !channel->is_done) {
+      pthread_cond_wait(&channel->changed, &channel->lock);
+    }
+    if (channel->filled > 0) {
+      parser->block = &channel->blocks[channel->first];
+      parser->block_position = 0;
+    }
+  }
+  pthread_mutex_unlock(&channel->lock);
+
+  if (parser->block == NULL) {
+    parser->status = END_OF_FILE;
+    return;
+  }
+
+  *parser->next_request = parser->block->requests[parser->block_position++];
+  parser->status = OK;
 }
 
 void parser_next_line(Parser_t *parser) {
-  if (fgets(parser->line, sizeof(parser->line), parser->file)) {
+  if (parser->feed != NULL) {
+    parser_next_fed(parser);
+    return;
+  }
+  if (parser->is_binary) {
+    parser_next_record(parser);
+    return;
+  }
+
+  const char *end_of_file = parser->data + parser->size;
+
+  while (parser->position < parser->size) {
+    const char *line = parser->data + parser->position;
+    const char *end = memchr(line, '\n', end_of_file - line);
+    end = (end == NULL) ? end_of_file : end + 1;
+    parser->position = end - parser->data;
+
     // skip empty lines
-    if (strlen(parser->line) == 1) {
-      parser_next_line(parser);
-      return;
+    const char *c = line;
+    while (c < end && isspace((unsigned char)*c)) {
+      c++;
+    }
+    if (c == end) {
+      continue;
     }
 
-    parser->next_request = malloc(sizeof(MemoryRequest_t));
+    parse_line(line, end, parser->next_request);
+    parser->status = OK;
+    return;
+  }
 
-    if (parser->next_request == NULL) {
-      perror("Error allocating memory for next request");
-      exit(EXIT_FAILURE);
+  parser->status = END_OF_FILE;
+}
+
+static void __attribute__((noreturn)) invalid_input(const char *format, ...) {
+  // simulations on other threads may reach bad input too; the first one to report it
+  // holds stderr and the others wait here until the process exits
+  flockfile(stderr);
+
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+
+  exit(EXIT_FAILURE);
+}
+
+static const char *next_token(const char *c, const char *end, const char **token_end) {
+  while (c < end && isspace((unsigned char)*c)) {
+    c++;
+  }
+
+  *token_end = c;
+  while (*token_end < end && !isspace((unsigned char)**token_end)) {
+    (*token_end)++;
+  }
+
+  return c;
+}
+
+static bool parse_decimal(const char *c, const char *end, uint64_t *value) {
+  *value = 0;
+
+  if (c == end) {
+    return false;
+  }
+
+  for (; c < end; c++) {
+    if (*c < '0' || *c > '9') {
+      return false;
     }
 
-    *parser->next_request = parse_line(parser->line);
-    parser->status = OK;
+    uint64_t digit = *c - '0';
+    *value = (*value > (UINT64_MAX - digit) / 10) ? UINT64_MAX : *value * 10 + digit;
+  }
 
-  } else {
-    parser->status = END_OF_FILE;
+  return true;
+}
+
+static bool parse_hex(const char *c, const char *end, uint64_t *value) {
+  *value = 0;
+
+  if (end - c > 2 && c[0] == '0' && (c[1] == 'x' || c[1] == 'X')) {
+    c += 2;
   }
+
+  if (c == end) {
+    return false;
+  }
+
+  for (; c < end; c++) {
+    uint64_t digit;
+    if (*c >= '0' && *c <= '9') {
+      digit = *c - '0';
+    }
+    else if (*c >= 'a' && *c <= 'f') {
+      digit = *c - 'a' + 10;
+    }
+    else if (*c >= 'A' && *c <= 'F') {
+      digit = *c - 'A' + 10;
+    }
+    else {
+      return false;
+    }
+
+    *value = (*value >> 60) ? UINT64_MAX : (*value << 4) | digit;
+  }
+
+  return true;
 }
 
-MemoryRequest_t parse_line(char *line) {
-  char time_str[21], core_str[4], operation_str[3], address_str[21];
-  uint64_t time, address;
-  uint8_t core, operation;
-  MemoryRequest_t memory_request;
+void parse_line(const char *line, const char *end, MemoryRequest_t *memory_request) {
+  const char *token[4], *token_end[4];
+  uint64_t time, core, operation, address;
+  int line_length = end - line;
 
-  if (sscanf(line, "%20s %3s %2s %20s", time_str, core_str, operation_str, address_str) != 4) {
-    fprintf(stderr, "Error parsing line: %s\n", line);
-    exit(EXIT_FAILURE);
+  const char *c = line;
+  for (int i = 0; i < 4; i++) {
+    token[i] = next_token(c, end, &token_end[i]);
+    c = token_end[i];
+
+    if (token[i] == token_end[i]) {
+      invalid_input("Error parsing line: %.*s\n", line_length, line);
+    }
   }
 
   // Check for negative numbers
-  if (time_str[0] == '-' || core_str[0] == '-' || operation_str[0] == '-' || address_str[0] == '-') {
-    fprintf(stderr, "Error: Negative number detected in input: %s\n", line);
-    exit(EXIT_FAILURE);
+  if (token[0][0] == '-' || token[1][0] == '-' || token[2][0] == '-' || token[3][0] == '-') {
+    invalid_input("Error: Negative number detected in input: %.*s\n", line_length, line);
   }
 
-  time = strtoull(time_str, NULL, 10);
-  core = strtoul(core_str, NULL, 10);
-  operation = strtoul(operation_str, NULL, 10);
-  address = strtoull(address_str, NULL, 16);
+  if (
+    !parse_decimal(token[0], token_end[0], &time) ||
+    !parse_decimal(token[1], token_end[1], &core) ||
+    !parse_decimal(token[2], token_end[2], &operation) ||
+    !parse_hex(token[3], token_end[3], &address)
+  ) {
+    invalid_input("Error parsing line: %.*s\n", line_length, line);
+  }
 
+  create_request(memory_request, time, core, operation, address);
+}
+
+void create_request(MemoryRequest_t *memory_request, uint64_t time, uint64_t core, uint64_t operation, uint64_t address) {
   // Check if core is out of range
   if (core > 11) {
-    fprintf(stderr, "Error: core value out of range (0-11): %u\n", core);
-    exit(EXIT_FAILURE);
+    invalid_input("Error: core value out of range (0-11): %" PRIu64 "\n", core);
   }
 
   // Check if operation is out of range
   if (operation > 2) {
-    fprintf(stderr, "Error: operation value out of range (0-2): %u\n", operation);
-    exit(EXIT_FAILURE);
+    invalid_input("Error: operation value out of range (0-2): %" PRIu64 "\n", operation);
   }
 
   // Check if address is more than 34 bits
   if (address > ((uint64_t)1 << 34) - 1) {
-    fprintf(stderr, "Error: address is more than 34 bits: %" PRIx64 "\n", address);
-    exit(EXIT_FAILURE);
-  }
-
-  memory_request_init(&memory_request, time, core, operation, address);
-
-  // Check if channel is out of range
-  if (memory_request.channel != 0) {
-    fprintf(stderr, "Error: request at time %" PRIu64 " has channel %u != 0\n", memory_request.time, memory_request.channel);
-    exit(EXIT_FAILURE);
+    invalid_input("Error: address is more than 34 bits: %" PRIx64 "\n", address);
   }
 
-  return memory_request;
+  memory_request_init(memory_request, time, core, operation, address);
 }
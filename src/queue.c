@@ -13,157 +13,534 @@
 #include "common.h"
 #include "queue.h"
 
-int8_t queue_create(Queue_t **q, uint8_t max_size) {
+/*** helper function(s) ***/
+static inline uint16_t slot_of(Queue_t *q, MemoryRequest_t *request) {
+    return (uint16_t)(request - q->slots);
+}
 
-    *q = (Queue_t *)malloc(sizeof(Queue_t));
+static inline MemoryRequest_t *request_at(Queue_t *q, uint16_t slot) {
+    return (slot == QUEUE_NO_SLOT) ? NULL : &(q->slots[slot]);
+}
 
-    if (q == NULL) {
-        fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+static inline int bank_of(MemoryRequest_t *request) {
+    return request->bank_group * NUM_BANKS_PER_GROUP + request->bank;
+}
+
+static void renumber(Queue_t *q) {
+    // spread the order keys out again once two neighbours have run out of room between them
+    uint64_t key = QUEUE_KEY_GAP;
+    for (uint16_t slot = q->head; slot != QUEUE_NO_SLOT; slot = q->next[slot]) {
+        q->order_key[slot] = key;
+        key += QUEUE_KEY_GAP;
     }
+}
 
-    (*q)->list = NULL;
-    (*q)->size = 0;
-    (*q)->max_size = max_size;
+static uint64_t key_before(Queue_t *q, uint16_t position) {
+    // an order key between position and the slot ahead of it; position == QUEUE_NO_SLOT is the back
+    while (true) {
+        uint16_t previous = (position == QUEUE_NO_SLOT) ? q->tail : q->prev[position];
+        uint64_t low = (previous == QUEUE_NO_SLOT) ? 0 : q->order_key[previous];
 
-    if (doubly_ll_create(&((*q)->list)) != LL_EXIT_SUCCESS) {
-        free(q);
-        fprintf(stderr, "%s:%d: queue_create failed\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+        if (position == QUEUE_NO_SLOT) {
+            if (low <= UINT64_MAX - QUEUE_KEY_GAP) {
+                return low + QUEUE_KEY_GAP;
+            }
+        }
+        else if (q->order_key[position] - low >= 2) {
+            return low + (q->order_key[position] - low) / 2;
+        }
+
+        renumber(q);
     }
+}
 
-    return LL_EXIT_SUCCESS;
+static void update_state_mask(Queue_t *q, int bank, MemoryRequestState_t state) {
+    uint32_t bit = (uint32_t)1 << bank;
+    q->state_banks[state] = (q->banks[bank].state_head[state] != QUEUE_NO_SLOT) ? (q->state_banks[state] | bit) : (q->state_banks[state] & ~bit);
 }
 
-void queue_destroy(Queue_t **q) {
+static void update_started_mask(Queue_t *q, int bank) {
+    uint32_t bit = (uint32_t)1 << bank;
+    q->started_banks = (q->banks[bank].started_head != QUEUE_NO_SLOT) ? (q->started_banks | bit) : (q->started_banks & ~bit);
+}
 
-    if (*q != NULL) {
-        int8_t result = doubly_ll_destroy(&((*q)->list));
+static void list_link(Queue_t *q, uint16_t slot, uint16_t *head, uint16_t *tail, uint16_t *next_slot, uint16_t *prev_slot) {
+    // files the slot in a bank list at its place in queue order.
+    // requests are mostly added at the back, so look for the one ahead of it from the tail
+    uint16_t previous = *tail;
+    while (previous != QUEUE_NO_SLOT && q->order_key[previous] > q->order_key[slot]) {
+        previous = prev_slot[previous];
+    }
+    uint16_t next = (previous == QUEUE_NO_SLOT) ? *head : next_slot[previous];
 
-        if (result != LL_EXIT_SUCCESS) {
-            fprintf(stderr, "%s:%d: queue_destroy failed\n", __FILE__, __LINE__);
-            exit(EXIT_FAILURE);
-        }
-        
-        free(*q);
-        *q = NULL;
+    prev_slot[slot] = previous;
+    next_slot[slot] = next;
+    if (previous == QUEUE_NO_SLOT) {
+        *head = slot;
+    }
+    else {
+        next_slot[previous] = slot;
+    }
+    if (next == QUEUE_NO_SLOT) {
+        *tail = slot;
+    }
+    else {
+        prev_slot[next] = slot;
     }
 }
 
-int8_t queue_insert_at(Queue_t **q, uint8_t index, MemoryRequest_t value) {
-    if (*q == NULL || (*q)->list == NULL) {
-        return LL_EXIT_USER_ERR; // Invalid queue
+static void list_unlink(uint16_t slot, uint16_t *head, uint16_t *tail, uint16_t *next_slot, uint16_t *prev_slot) {
+    uint16_t previous = prev_slot[slot];
+    uint16_t next = next_slot[slot];
+
+    if (previous == QUEUE_NO_SLOT) {
+        *head = next;
+    }
+    else {
+        next_slot[previous] = next;
+    }
+    if (next == QUEUE_NO_SLOT) {
+        *tail = previous;
     }
+    else {
+        prev_slot[next] = previous;
+    }
+}
 
-    // queue should never overflow if main loop logic is correct
-    if ( queue_is_full(*q) ) {
-        fprintf(stderr, "%s:%d: Queue overflow\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+static void state_link(Queue_t *q, uint16_t slot) {
+    // files the slot in the list of the state in filed_state, and counts it if it is pending to the open row
+    MemoryRequest_t *request = &q->slots[slot];
+    QueueBank_t *bank_lists = &q->banks[bank_of(request)];
+    MemoryRequestState_t state = q->filed_state[slot];
+
+    list_link(q, slot, &bank_lists->state_head[state], &bank_lists->state_tail[state], q->state_next, q->state_prev);
+    if (state == PENDING && request->row == bank_lists->open_row) {
+        bank_lists->open_row_pending++;
     }
+    update_state_mask(q, bank_of(request), state);
+}
 
-    
-    int8_t result = doubly_ll_insert_at(&((*q)->list), index, value);
-    if (result != LL_EXIT_SUCCESS) {
-        fprintf(stderr, "%s:%d: queue_insert_at failed\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+static void state_unlink(Queue_t *q, uint16_t slot) {
+    MemoryRequest_t *request = &q->slots[slot];
+    QueueBank_t *bank_lists = &q->banks[bank_of(request)];
+    MemoryRequestState_t state = q->filed_state[slot];
+
+    list_unlink(slot, &bank_lists->state_head[state], &bank_lists->state_tail[state], q->state_next, q->state_prev);
+    if (state == PENDING && request->row == bank_lists->open_row) {
+        bank_lists->open_row_pending--;
     }
+    update_state_mask(q, bank_of(request), state);
+}
 
-    (*q)->size++;
-    return result;
+static void started_link(Queue_t *q, uint16_t slot) {
+    int bank = bank_of(&q->slots[slot]);
+    list_link(q, slot, &q->banks[bank].started_head, &q->banks[bank].started_tail, q->bank_next, q->bank_prev);
+    update_started_mask(q, bank);
 }
 
-int8_t enqueue(Queue_t **q, MemoryRequest_t value) {
-    if (*q == NULL || (*q)->list == NULL) {
-        return LL_EXIT_USER_ERR; // Invalid queue
+static void started_unlink(Queue_t *q, uint16_t slot) {
+    int bank = bank_of(&q->slots[slot]);
+    list_unlink(slot, &q->banks[bank].started_head, &q->banks[bank].started_tail, q->bank_next, q->bank_prev);
+    update_started_mask(q, bank);
+}
+
+static bool should_lead(Queue_t *q, uint16_t slot) {
+    // a pending request leads unless the request ahead of it in the queue is a pending one to the same bank
+    uint16_t previous = q->prev[slot];
+    return q->filed_state[slot] == PENDING &&
+           (previous == QUEUE_NO_SLOT || q->filed_state[previous] != PENDING || bank_of(&q->slots[previous]) != bank_of(&q->slots[slot]));
+}
+
+static void update_lead(Queue_t *q, uint16_t slot) {
+    // files the slot in or out of its bank's leader list after its state or the slot ahead of it changed
+    if (slot == QUEUE_NO_SLOT || should_lead(q, slot) == (q->is_leading[slot] != 0)) {
+        return;
     }
 
+    QueueBank_t *bank_lists = &q->banks[bank_of(&q->slots[slot])];
+    if (q->is_leading[slot]) {
+        list_unlink(slot, &bank_lists->lead_head, &bank_lists->lead_tail, q->lead_next, q->lead_prev);
+    }
+    else {
+        list_link(q, slot, &bank_lists->lead_head, &bank_lists->lead_tail, q->lead_next, q->lead_prev);
+    }
+    q->is_leading[slot] = !q->is_leading[slot];
+}
+
+static void bank_link(Queue_t *q, uint16_t slot) {
+    // files the slot in its bank's lists by the state it is queued in
+    q->filed_state[slot] = q->slots[slot].state;
+    state_link(q, slot);
+    if (q->filed_state[slot] != PENDING) {
+        started_link(q, slot);
+    }
+}
+
+static void bank_unlink(Queue_t *q, uint16_t slot) {
+    if (q->filed_state[slot] != PENDING) {
+        started_unlink(q, slot);
+    }
+    state_unlink(q, slot);
+}
+
+static uint16_t take_free_slot(Queue_t *q, MemoryRequest_t value) {
+    uint16_t slot = q->free_slots[--q->free_count];
+    q->slots[slot] = value;
+    return slot;
+}
+
+static void release_slot(Queue_t *q, uint16_t slot) {
+    q->free_slots[q->free_count++] = slot;
+}
+
+static void link_before(Queue_t *q, uint16_t slot, uint16_t position) {
+    // position == QUEUE_NO_SLOT links the slot in at the back
+    q->order_key[slot] = key_before(q, position);
+    uint16_t previous = (position == QUEUE_NO_SLOT) ? q->tail : q->prev[position];
+
+    q->next[slot] = position;
+    q->prev[slot] = previous;
+
+    if (previous == QUEUE_NO_SLOT) {
+        q->head = slot;
+    }
+    else {
+        q->next[previous] = slot;
+    }
+
+    if (position == QUEUE_NO_SLOT) {
+        q->tail = slot;
+    }
+    else {
+        q->prev[position] = slot;
+    }
+
+    bank_link(q, slot);
+    q->is_leading[slot] = 0;
+    update_lead(q, slot);
+    update_lead(q, position);
+    q->banks[bank_of(&q->slots[slot])].count++;
+    q->size++;
+}
+
+static MemoryRequest_t unlink_slot(Queue_t *q, uint16_t slot) {
+    if (q->is_leading[slot]) {
+        QueueBank_t *bank_lists = &q->banks[bank_of(&q->slots[slot])];
+        list_unlink(slot, &bank_lists->lead_head, &bank_lists->lead_tail, q->lead_next, q->lead_prev);
+    }
+    bank_unlink(q, slot);
+    q->banks[bank_of(&q->slots[slot])].count--;
+
+    uint16_t previous = q->prev[slot];
+    uint16_t next = q->next[slot];
+
+    if (previous == QUEUE_NO_SLOT) {
+        q->head = next;
+    }
+    else {
+        q->next[previous] = next;
+    }
+
+    if (next == QUEUE_NO_SLOT) {
+        q->tail = previous;
+    }
+    else {
+        q->prev[next] = previous;
+    }
+    update_lead(q, next);
+
+    MemoryRequest_t stored_item = q->slots[slot];
+    release_slot(q, slot);
+    q->size--;
+    return stored_item;
+}
+
+static void check_insert(Queue_t *q) {
     // queue should never overflow if main loop logic is correct
-    if ( queue_is_full(*q) ) {
+    if ( queue_is_full(q) ) {
         fprintf(stderr, "%s:%d: Queue overflow\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
     }
+}
 
-    
-    int8_t result = doubly_ll_insert_head(&((*q)->list), value);
-    if (result != LL_EXIT_SUCCESS) {
-        fprintf(stderr, "%s:%d: enqueue failed\n", __FILE__, __LINE__);
+static void check_remove(Queue_t *q) {
+    if (q == NULL || q->slots == NULL) {
+        fprintf(stderr, "%s:%d: Removing from an invalid queue\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
     }
 
-    (*q)->size++;
-    return result;
+    // if main loop logic is correct; we should never request from an empty queue
+    if ( queue_is_empty(q) ) {
+        fprintf(stderr, "%s:%d: Dequeueing an empty queue\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
 }
 
-MemoryRequest_t queue_delete_at(Queue_t **q, uint8_t index) {
-    if (*q == NULL || (*q)->list == NULL) {
-        fprintf(stderr, "%s:%d: queue_delete_at failed\n", __FILE__, __LINE__);
+/*** function(s) ***/
+int8_t queue_create(Queue_t **q, uint64_t max_size) {
+
+    *q = (Queue_t *)malloc(sizeof(Queue_t));
+
+    if (*q == NULL) {
+        fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
     }
 
-    // if main loop logic is correct; we should never request from an empty queue
-    if ( queue_is_empty(*q) ) {
-        fprintf(stderr, "%s:%d: Dequeueing an empty queue\n", __FILE__, __LINE__);
+    // aligned_alloc needs the size to be a multiple of the alignment
+    size_t slots_size = max_size * sizeof(MemoryRequest_t);
+    slots_size = (slots_size + QUEUE_ALIGNMENT - 1) / QUEUE_ALIGNMENT * QUEUE_ALIGNMENT;
+
+    (*q)->slots = aligned_alloc(QUEUE_ALIGNMENT, slots_size);
+    (*q)->next = malloc(max_size * sizeof(uint16_t));
+    (*q)->prev = malloc(max_size * sizeof(uint16_t));
+    (*q)->free_slots = malloc(max_size * sizeof(uint16_t));
+    (*q)->bank_next = malloc(max_size * sizeof(uint16_t));
+    (*q)->bank_prev = malloc(max_size * sizeof(uint16_t));
+    (*q)->state_next = malloc(max_size * sizeof(uint16_t));
+    (*q)->state_prev = malloc(max_size * sizeof(uint16_t));
+    (*q)->order_key = malloc(max_size * sizeof(uint64_t));
+    (*q)->filed_state = malloc(max_size * sizeof(uint8_t));
+    (*q)->lead_next = malloc(max_size * sizeof(uint16_t));
+    (*q)->lead_prev = malloc(max_size * sizeof(uint16_t));
+    (*q)->is_leading = malloc(max_size * sizeof(uint8_t));
+    (*q)->head = QUEUE_NO_SLOT;
+    (*q)->tail = QUEUE_NO_SLOT;
+    (*q)->size = 0;
+    (*q)->max_size = max_size;
+    (*q)->cycle = 0;
+
+    if (max_size == 0 || max_size > QUEUE_MAX_CAPACITY || (*q)->slots == NULL || (*q)->next == NULL || (*q)->prev == NULL || (*q)->free_slots == NULL ||
+        (*q)->bank_next == NULL || (*q)->bank_prev == NULL || (*q)->state_next == NULL || (*q)->state_prev == NULL ||
+        (*q)->order_key == NULL || (*q)->filed_state == NULL || (*q)->lead_next == NULL || (*q)->lead_prev == NULL || (*q)->is_leading == NULL) {
+        fprintf(stderr, "%s:%d: queue_create failed\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
     }
 
-    // Delete at the head of the linked list (dequeue operation)
-    MemoryRequest_t stored_item = doubly_ll_delete_at(&((*q)->list), index);
+    // hand out low slots first
+    for (uint64_t i = 0; i < max_size; i++) {
+        (*q)->free_slots[i] = max_size - 1 - i;
+    }
+    (*q)->free_count = max_size;
+
+    for (int bank = 0; bank < NUM_BANKS; bank++) {
+        QueueBank_t *bank_lists = &(*q)->banks[bank];
+        for (int state = 0; state < NUM_REQUEST_STATES; state++) {
+            bank_lists->state_head[state] = QUEUE_NO_SLOT;
+            bank_lists->state_tail[state] = QUEUE_NO_SLOT;
+            (*q)->state_banks[state] = 0;
+        }
+        bank_lists->started_head = QUEUE_NO_SLOT;
+        bank_lists->started_tail = QUEUE_NO_SLOT;
+        bank_lists->lead_head = QUEUE_NO_SLOT;
+        bank_lists->lead_tail = QUEUE_NO_SLOT;
+        bank_lists->count = 0;
+        bank_lists->open_row = 0;
+        bank_lists->open_row_pending = 0;
+    }
+    (*q)->started_banks = 0;
 
-    (*q)->size--;
-    return stored_item;
+    return QUEUE_EXIT_SUCCESS;
 }
 
-MemoryRequest_t dequeue(Queue_t **q) {
-    if (*q == NULL || (*q)->list == NULL) {
-        fprintf(stderr, "%s:%d: dequeue failed\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+void queue_destroy(Queue_t **q) {
+
+    if (*q != NULL) {
+        free((*q)->slots);
+        free((*q)->next);
+        free((*q)->prev);
+        free((*q)->free_slots);
+        free((*q)->bank_next);
+        free((*q)->bank_prev);
+        free((*q)->state_next);
+        free((*q)->state_prev);
+        free((*q)->order_key);
+        free((*q)->filed_state);
+        free((*q)->lead_next);
+        free((*q)->lead_prev);
+        free((*q)->is_leading);
+        free(*q);
+        *q = NULL;
     }
+}
 
-    // if main loop logic is correct; we should never request from an empty queue
-    if ( queue_is_empty(*q) ) {
-        fprintf(stderr, "%s:%d: Dequeueing an empty queue\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+int8_t queue_insert_before(Queue_t **q, MemoryRequest_t *position, MemoryRequest_t value) {
+    // position == NULL inserts at the back
+    if (*q == NULL || (*q)->slots == NULL) {
+        return QUEUE_EXIT_USER_ERR; // Invalid queue
     }
 
-    // Delete at the head of the linked list (dequeue operation)
-    MemoryRequest_t stored_item = doubly_ll_delete_tail(&((*q)->list));
+    check_insert(*q);
 
-    (*q)->size--;
-    return stored_item;
+    link_before(*q, take_free_slot(*q, value), (position == NULL) ? QUEUE_NO_SLOT : slot_of(*q, position));
+    return QUEUE_EXIT_SUCCESS;
+}
+
+int8_t queue_insert_after(Queue_t **q, MemoryRequest_t *position, MemoryRequest_t value) {
+    // position == NULL inserts at the front
+    if (*q == NULL || (*q)->slots == NULL) {
+        return QUEUE_EXIT_USER_ERR; // Invalid queue
+    }
+
+    check_insert(*q);
+
+    uint16_t next = (position == NULL) ? (*q)->head : (*q)->next[slot_of(*q, position)];
+    link_before(*q, take_free_slot(*q, value), next);
+    return QUEUE_EXIT_SUCCESS;
+}
+
+int8_t enqueue(Queue_t **q, MemoryRequest_t value) {
+    if (*q == NULL || (*q)->slots == NULL) {
+        return QUEUE_EXIT_USER_ERR; // Invalid queue
+    }
+
+    check_insert(*q);
+
+    link_before(*q, take_free_slot(*q, value), QUEUE_NO_SLOT);
+    return QUEUE_EXIT_SUCCESS;
+}
+
+MemoryRequest_t queue_remove(Queue_t **q, MemoryRequest_t *request) {
+    // request must point into the queue; its slot is free again once this returns
+    check_remove(*q);
+
+    return unlink_slot(*q, slot_of(*q, request));
+}
+
+MemoryRequest_t dequeue(Queue_t **q) {
+    check_remove(*q);
+
+    // remove from the front of the queue
+    return unlink_slot(*q, (*q)->head);
 }
 
 MemoryRequest_t *queue_peek(Queue_t *q) {
-    if (q == NULL || q->list == NULL) {
+    if (q == NULL || q->slots == NULL) {
         return NULL;
     }
 
-    if ( queue_is_empty(q) ) {
-        return NULL;
+    return request_at(q, q->head);
+}
+
+MemoryRequest_t *queue_next(Queue_t *q, MemoryRequest_t *request) {
+    // the request behind this one, NULL at the back of the queue
+    return request_at(q, q->next[slot_of(q, request)]);
+}
+
+MemoryRequest_t *queue_prev(Queue_t *q, MemoryRequest_t *request) {
+    // the request ahead of this one, NULL at the front of the queue
+    return request_at(q, q->prev[slot_of(q, request)]);
+}
+
+MemoryRequest_t *queue_bank_pending(Queue_t *q, int bank) {
+    // the bank's first request that has not started, NULL if there is none
+    return request_at(q, q->banks[bank].state_head[PENDING]);
+}
+
+MemoryRequest_t *queue_bank_started(Queue_t *q, int bank) {
+    // the bank's first request that has started, NULL if there is none
+    return request_at(q, q->banks[bank].started_head);
+}
+
+MemoryRequest_t *queue_bank_next(Queue_t *q, MemoryRequest_t *request) {
+    // the request behind this one in its bank's pending or started list, NULL at the back
+    uint16_t slot = slot_of(q, request);
+    return request_at(q, (q->filed_state[slot] == PENDING) ? q->state_next[slot] : q->bank_next[slot]);
+}
+
+MemoryRequest_t *queue_bank_state(Queue_t *q, int bank, MemoryRequestState_t state) {
+    // the bank's first request in the state, NULL if there is none
+    return request_at(q, q->banks[bank].state_head[state]);
+}
+
+MemoryRequest_t *queue_state_next(Queue_t *q, MemoryRequest_t *request) {
+    // the request behind this one in its bank's list of its state, NULL at the back
+    return request_at(q, q->state_next[slot_of(q, request)]);
+}
+
+MemoryRequest_t *queue_bank_leader(Queue_t *q, int bank) {
+    // the bank's first pending request that leads, NULL if there is none
+    return request_at(q, q->banks[bank].lead_head);
+}
+
+MemoryRequest_t *queue_leader_next(Queue_t *q, MemoryRequest_t *request) {
+    // the leading pending request behind this one in its bank, NULL at the back. a request that
+    // stopped leading since it was handed out goes on along the bank's pending list
+    uint16_t slot = slot_of(q, request);
+    if (q->is_leading[slot]) {
+        return request_at(q, q->lead_next[slot]);
+    }
+
+    slot = (q->filed_state[slot] == PENDING) ? q->state_next[slot] : QUEUE_NO_SLOT;
+    while (slot != QUEUE_NO_SLOT && !q->is_leading[slot]) {
+        slot = q->state_next[slot];
     }
+    return request_at(q, slot);
+}
 
-    return doubly_ll_value_at_tail(q->list);
+uint32_t queue_state_banks(Queue_t *q, MemoryRequestState_t state) {
+    return q->state_banks[state];
 }
 
-MemoryRequest_t *queue_peek_at(Queue_t *q, uint8_t index) {
-    if (q == NULL || q->list == NULL) {
-        return NULL;
+uint32_t queue_bank_count(Queue_t *q, int bank) {
+    return q->banks[bank].count;
+}
+
+uint32_t queue_queued_banks(Queue_t *q) {
+    return q->state_banks[PENDING] | q->started_banks;
+}
+
+void queue_update_state(Queue_t *q, MemoryRequest_t *request) {
+    // refiles a request whose state changed. it only joins the started list when it leaves PENDING
+    uint16_t slot = slot_of(q, request);
+    if (q->filed_state[slot] == request->state) {
+        return;
     }
 
-    if (queue_is_empty(q)) {
-        return NULL;
+    bool was_pending = q->filed_state[slot] == PENDING;
+    state_unlink(q, slot);
+    q->filed_state[slot] = request->state;
+    state_link(q, slot);
+    if (was_pending) {
+        started_link(q, slot);
     }
+    update_lead(q, slot);
+    update_lead(q, q->next[slot]);
+}
 
-    // queue index starts at 0
-    if (index > 15) {
-        fprintf(stderr, "%s:%d: queue_peek_at out of range. index > 15\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+void queue_set_open_row(Queue_t *q, int bank, uint32_t row) {
+    // the row opened in the bank; its pending requests to that row are counted from here on
+    QueueBank_t *bank_lists = &q->banks[bank];
+    if (bank_lists->open_row == row) {
+        return;
+    }
+
+    bank_lists->open_row = row;
+    bank_lists->open_row_pending = 0;
+    for (uint16_t slot = bank_lists->state_head[PENDING]; slot != QUEUE_NO_SLOT; slot = q->state_next[slot]) {
+        bank_lists->open_row_pending += q->slots[slot].row == row;
     }
+}
+
+uint32_t queue_open_row_pending(Queue_t *q, int bank) {
+    return q->banks[bank].open_row_pending;
+}
+
+bool queue_is_ahead(Queue_t *q, MemoryRequest_t *request, MemoryRequest_t *other) {
+    // both requests must be in the queue
+    return q->order_key[slot_of(q, request)] < q->order_key[slot_of(q, other)];
+}
 
-    return doubly_ll_value_at(q->list, index);
+uint64_t queue_order_key(Queue_t *q, MemoryRequest_t *request) {
+    // grows along the queue; keys change when the queue is renumbered, which only adding a request does
+    return q->order_key[slot_of(q, request)];
+}
+
+bool queue_holds(Queue_t *q, MemoryRequest_t *request) {
+    return request >= q->slots && request < q->slots + q->max_size;
 }
 
 bool queue_is_full(Queue_t *q) {
-    if (q == NULL || q->list == NULL) {
+    if (q == NULL || q->slots == NULL) {
         return false;
     }
 
@@ -171,7 +548,7 @@ bool queue_is_full(Queue_t *q) {
 }
 
 bool queue_is_empty(Queue_t *q) {
-    if (q == NULL || q->list == NULL) {
+    if (q == NULL || q->slots == NULL) {
         return true; 
     }
 
@@ -179,34 +556,30 @@ bool queue_is_empty(Queue_t *q) {
 }
 
 void print_queue(Queue_t *q) {
-    if (q == NULL || q->list == NULL)
+    if (q == NULL || q->slots == NULL)
         return; 
 
     if (queue_is_empty(q))
         return;
 
-    doubly_ll_print_list(q->list);
-}
-
-void queue_swap(Queue_t **q, uint8_t i1, uint8_t i2) {
-    if (*q == NULL || (*q)->list == NULL) {
-        fprintf(stderr, "%s:%d: Invalid index for swap\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
+    LOG("queue (size = %" PRIu64 "): \n", q->size);
+
+    for (MemoryRequest_t *request = queue_peek(q); request != NULL; request = queue_next(q, request)) {
+        LOG(
+            "CORE: %hhu, OPERATION: %hhu\n"
+            "BG: %hhu, BA: %hhu\n"
+            "ROW: %04X, COLH: %02X, COLL: %0X\n"
+            "|   \n"
+            "V   \n",
+            request->core,
+            request->operation,
+            request->bank_group,
+            request->bank,
+            request->row,
+            request->column_high,
+            request->column_low
+        );
     }
 
-    if (i1 >= (*q)->size || i2 >= (*q)->size || i1 == i2) {
-        fprintf(stderr, "%s:%d: Invalid index for swap\n", __FILE__, __LINE__);
-        exit(EXIT_FAILURE);
-    }
-
-    MemoryRequest_t *request1 = doubly_ll_value_at((*q)->list, i1);
-    MemoryRequest_t *request2 = doubly_ll_value_at((*q)->list, i2);
-
-    // Swap the values in the queue
-    doubly_ll_delete_at(&((*q)->list), i1);
-    doubly_ll_insert_at(&((*q)->list), i1, *request2);
-
-    doubly_ll_delete_at(&((*q)->list), i2);
-    doubly_ll_insert_at(&((*q)->list), i2, *request1);
+    LOG("NULL\n\n");
 }
-
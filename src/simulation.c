@@ -0,0 +1,370 @@
+/**
+ * @file  simulation.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <pthread.h>
+#include "simulation.h"
+#include "dimm.h"
+#include "memory_request.h"
+#include "parser.h"
+#include "queue.h"
+
+/*** struct(s) ***/
+typedef struct ChannelSimulation {
+  SimulationConfig_t *config;
+  DIMM_t *dimm;
+  TraceFeed_t *feed;       // the trace, parsed once for every channel
+  uint8_t channel;
+  uint64_t clock_cycle;    // CPU clock cycle the channel finished at
+  uint64_t request_count;
+  uint64_t forwarded_reads;
+  uint64_t merged_writes;
+} ChannelSimulation_t;
+
+/*** helper function(s) ***/
+void *simulate_channel(void *arg);
+bool enqueue_request(ChannelSimulation_t *simulation, Queue_t *global_queue, Queue_t *write_queue, MemoryRequest_t *request, uint64_t clock_cycle);
+MemoryRequest_t *find_buffered_write(Queue_t *write_queue, MemoryRequest_t *request, bool unissued_only);
+void record_served_request(ChannelSimulation_t *simulation, MemoryRequest_t *request, uint64_t clock_cycle);
+void out_of_order(Queue_t *global_queue, MemoryRequest_t *current_request);
+MemoryRequest_t *first_bank_request(Queue_t *q, MemoryRequest_t *request, bool is_write, bool is_same_row);
+bool queues_are_empty(Queue_t *global_queue, Queue_t *write_queue);
+void advance_clock(uint64_t *clock_cycle, DIMM_t *dimm, uint8_t channel, Queue_t *global_queue, Queue_t *write_queue, Parser_t *parser, bool is_dimm_cycle_idle);
+void fast_forward_clock(uint64_t *clock_cycle, DIMM_t **dimm, uint8_t channel, Queue_t **global_queue, Queue_t **write_queue, Parser_t *parser, MemoryRequest_t *current_request);
+
+/*** function(s) ***/
+void simulate(SimulationConfig_t *config, SimulationResult_t *result) {
+  ChannelSimulation_t channels[NUM_CHANNELS];
+  pthread_t threads[NUM_CHANNELS];
+  DIMM_t *PC5_38400 = NULL;
+  TraceFeed_t *feed = trace_feed_create(config->input_file, NUM_CHANNELS);
+
+  for (int i = 0; i < NUM_CHANNELS; i++) {
+    channels[i] = (ChannelSimulation_t){
+      .config = config,
+      .feed = feed,
+      .channel = i
+    };
+  }
+
+  dimm_create(&PC5_38400, config->output_file, config->output_format, config->refresh_mode, config->timeline_file, config->attribute_stalls);  // create DIMM
+
+  // channels only share the trace, so each one runs on its own thread (channel 0 on this one)
+  for (int i = 0; i < NUM_CHANNELS; i++) {
+    channels[i].dimm = PC5_38400;
+    if (i > 0 && pthread_create(&threads[i], NULL, simulate_channel, &channels[i]) != 0) {
+      fprintf(stderr, "Error: Could not start the thread for channel %d.\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  simulate_channel(&channels[0]);
+
+  result->total_cycles = channels[0].clock_cycle;
+  result->request_count = channels[0].request_count;
+  result->forwarded_reads = channels[0].forwarded_reads;
+  result->merged_writes = channels[0].merged_writes;
+  result->page_predictor = (PagePredictorStats_t){0};
+  memset(&result->latency, 0, sizeof(LatencyStats_t));
+  result->bandwidth = (BandwidthStats_t){0};
+  memset(result->stall_cycles, 0, sizeof(result->stall_cycles));
+  for (int i = 1; i < NUM_CHANNELS; i++) {
+    pthread_join(threads[i], NULL);
+    if (channels[i].clock_cycle > result->total_cycles) {
+      result->total_cycles = channels[i].clock_cycle;
+    }
+    result->request_count += channels[i].request_count;
+    result->forwarded_reads += channels[i].forwarded_reads;
+    result->merged_writes += channels[i].merged_writes;
+  }
+  trace_feed_destroy(feed);
+
+  for (int i = 0; i < NUM_CHANNELS; i++) {
+    PagePredictorStats_t *page_predictor = &PC5_38400->channels[i].page_predictor;
+    result->page_predictor.open_hits += page_predictor->open_hits;
+    result->page_predictor.open_misses += page_predictor->open_misses;
+    result->page_predictor.close_hits += page_predictor->close_hits;
+    result->page_predictor.close_misses += page_predictor->close_misses;
+    latency_merge(&result->latency, &PC5_38400->channels[i].latency);
+
+    BandwidthStats_t *bandwidth = &PC5_38400->channels[i].bandwidth;
+    finish_bandwidth_stats(&PC5_38400->channels[i], channels[i].clock_cycle);
+    if (PC5_38400->channels[i].timeline != NULL) {
+      timeline_finish(PC5_38400->channels[i].timeline, channels[i].clock_cycle);
+    }
+
+    if (PC5_38400->channels[i].stalls != NULL) {
+      memcpy(result->stall_cycles[i], PC5_38400->channels[i].stalls->cycles, sizeof(result->stall_cycles[i]));
+    }
+    for (int j = 0; j < NUM_COMMAND_CODES; j++) {
+      result->bandwidth.commands[j] += bandwidth->commands[j];
+    }
+    result->bandwidth.data_bus_cycles += bandwidth->data_bus_cycles;
+    result->bandwidth.row_hits += bandwidth->row_hits;
+    result->bandwidth.row_misses += bandwidth->row_misses;
+    result->bandwidth.row_empties += bandwidth->row_empties;
+    result->bandwidth.bank_active_cycles += bandwidth->bank_active_cycles;
+    result->bandwidth.read_to_write += bandwidth->read_to_write;
+    result->bandwidth.write_to_read += bandwidth->write_to_read;
+  }
+
+  dimm_destroy(&PC5_38400);
+}
+
+void *simulate_channel(void *arg) {
+  ChannelSimulation_t *simulation = arg;
+  SimulationConfig_t *config = simulation->config;
+  Parser_t *parser = parser_init_feed(simulation->feed, simulation->channel);  // waits for the channel's first request
+  DIMM_t *PC5_38400 = simulation->dimm;
+  Queue_t *global_queue = NULL;
+  Queue_t *write_queue = NULL;  // only used with a separate write queue
+  Queue_t **write_q = NULL;
+
+  queue_create(&global_queue, config->queue_size);  // create queue (16 entries by default)
+  if (config->write_queue_size > 0) {
+    queue_create(&write_queue, config->write_queue_size);
+    write_q = &write_queue;
+  }
+
+  // the policy is fixed for the whole run, so its DIMM cycle is looked up once
+  SchedulerKernel_t run_dimm_cycle = scheduler_kernel(config->scheduling_policy, write_queue != NULL);
+
+  uint64_t clock_cycle = 0;  // tracking the clock cycle (CPU clock). DIMM cycles start on the edges of is_dimm_clock_edge.
+  uint64_t queue_full_since = UINT64_MAX;  // clock cycle current_request was first turned away at
+  MemoryRequest_t *current_request = NULL;
+
+  while (true) {
+    bool is_dimm_cycle_idle = false;
+
+    if (current_request == NULL) {
+      current_request = parser_next_request(parser, clock_cycle);  // only returns the request if the current cycle >= request's time
+    }
+
+    // DIMM clock cycle - only process request if there is one in the queue, or refresh while the queues are empty
+    if (is_dimm_clock_edge(clock_cycle) && (!queues_are_empty(global_queue, write_queue) || config->refresh_mode != REFRESH_OFF)) {
+      run_dimm_cycle(&PC5_38400, simulation->channel, &global_queue, write_q, clock_cycle);
+      increment_aging_in_queue(global_queue);
+      increment_aging_in_queue(write_queue);
+      is_dimm_cycle_idle = PC5_38400->channels[simulation->channel].is_idle;
+    }
+
+    // CPU clock cycle - enqueue if there is a request and queue is not full
+    if (current_request != NULL && enqueue_request(simulation, global_queue, write_queue, current_request, clock_cycle)) {
+      log_memory_request("Enqueued:", current_request, clock_cycle);
+      if (queue_full_since != UINT64_MAX) {
+        record_queue_full(&PC5_38400->channels[simulation->channel], current_request, clock_cycle - queue_full_since);
+        queue_full_since = UINT64_MAX;
+      }
+      current_request = NULL;
+      simulation->request_count++;
+      is_dimm_cycle_idle = false;  // the next DIMM cycle has a new request to look at
+    }
+    else if (current_request != NULL && queue_full_since == UINT64_MAX) {
+      queue_full_since = clock_cycle;
+    }
+
+    if (parser->status == END_OF_FILE && queues_are_empty(global_queue, write_queue)) {
+      LOG("END OF SIMULATION (channel %u)\n", simulation->channel);
+      break;
+    }
+
+    if (config->fast_forward && is_dimm_cycle_idle) {
+      fast_forward_clock(&clock_cycle, &PC5_38400, simulation->channel, &global_queue, write_q, parser, current_request);
+    }
+
+    advance_clock(&clock_cycle, PC5_38400, simulation->channel, global_queue, write_queue, parser, is_dimm_cycle_idle);
+  }
+
+  parser_destroy(parser);
+  queue_destroy(&global_queue);
+  if (write_queue != NULL) {
+    queue_destroy(&write_queue);
+  }
+
+  simulation->clock_cycle = clock_cycle;
+  return NULL;
+}
+
+bool enqueue_request(ChannelSimulation_t *simulation, Queue_t *global_queue, Queue_t *write_queue, MemoryRequest_t *request, uint64_t clock_cycle) {
+  /**
+   * @brief Puts an arriving request in its queue. With a separate write queue, a read of a
+   *        buffered line is served from the write queue and a write to a line that is still
+   *        waiting there replaces the buffered data, so neither reaches the DRAM.
+   *
+   * @return bool  false if the request's queue is full and it has to wait
+   */
+  if (write_queue != NULL) {
+    if (request->operation != DATA_WRITE && find_buffered_write(write_queue, request, false) != NULL) {
+      LOG("Read forwarded from the write queue\n");
+      simulation->forwarded_reads++;
+      record_served_request(simulation, request, clock_cycle);
+      return true;
+    }
+
+    if (request->operation == DATA_WRITE) {
+      if (find_buffered_write(write_queue, request, true) != NULL) {
+        LOG("Write merged into a buffered write\n");
+        simulation->merged_writes++;
+        record_served_request(simulation, request, clock_cycle);
+        return true;
+      }
+      if (queue_is_full(write_queue)) {
+        return false;
+      }
+
+      request->enqueue_cycle = write_queue->cycle;
+      buffer_write(&simulation->dimm->channels[simulation->channel], global_queue, write_queue, request);
+      return true;
+    }
+  }
+
+  if (queue_is_full(global_queue)) {
+    return false;
+  }
+
+  request->enqueue_cycle = global_queue->cycle;
+  if (simulation->config->scheduling_policy == LEVEL_3) {
+    out_of_order(global_queue, request);
+
+  } else {
+    enqueue(&global_queue, *request);
+  }
+  return true;
+}
+
+MemoryRequest_t *find_buffered_write(Queue_t *write_queue, MemoryRequest_t *request, bool unissued_only) {
+  // a write holds its data until it leaves the queue, but can only be changed before its WR is issued.
+  // a line lives in one bank, so only that bank's writes are looked at
+  int bank = request->bank_group * NUM_BANKS_PER_GROUP + request->bank;
+  for (MemoryRequest_t *write = queue_bank_pending(write_queue, bank); write != NULL; write = queue_bank_next(write_queue, write)) {
+    if (is_same_cache_line(write, request)) {
+      return write;
+    }
+  }
+  for (MemoryRequest_t *write = queue_bank_started(write_queue, bank); write != NULL; write = queue_bank_next(write_queue, write)) {
+    if ((!unissued_only || !write->is_finished) && is_same_cache_line(write, request)) {
+      return write;
+    }
+  }
+
+  return NULL;
+}
+
+void record_served_request(ChannelSimulation_t *simulation, MemoryRequest_t *request, uint64_t clock_cycle) {
+  // a forwarded read or merged write is done as soon as it arrives at the queue
+  request->first_command_cycle = clock_cycle;
+  request->data_complete_cycle = clock_cycle;
+  latency_record(&simulation->dimm->channels[simulation->channel].latency, request, clock_cycle);
+}
+
+bool queues_are_empty(Queue_t *global_queue, Queue_t *write_queue) {
+  return queue_is_empty(global_queue) && (write_queue == NULL || queue_is_empty(write_queue));
+}
+
+void advance_clock(uint64_t *clock_cycle, DIMM_t *dimm, uint8_t channel, Queue_t *global_queue, Queue_t *write_queue, Parser_t *parser, bool is_dimm_cycle_idle) {
+  if (queues_are_empty(global_queue, write_queue) && parser->next_request->time > *clock_cycle) {
+    uint64_t next_cycle = parser->next_request->time;
+
+    // with refresh on the DIMM keeps running: after an idle DIMM cycle nothing happens before its next deadline
+    if (dimm->refresh_mode != REFRESH_OFF) {
+      uint64_t next_ready_at = dimm->channels[channel].DDR5_chip[0].next_ready_at;
+      if (!is_dimm_cycle_idle) {
+        next_cycle = *clock_cycle + 1;
+      } else if (next_ready_at <= dimm_cycle_at(next_cycle - 1)) {
+        next_cycle = cpu_cycle_of(next_ready_at);
+      }
+    }
+
+    LOG("No requests are processing. Advancing clock to %" PRIu64 "\n", next_cycle);
+    *clock_cycle = next_cycle;
+  } else {
+    *clock_cycle += 1;
+  }
+}
+
+void fast_forward_clock(uint64_t *clock_cycle, DIMM_t **dimm, uint8_t channel, Queue_t **global_queue, Queue_t **write_queue, Parser_t *parser, MemoryRequest_t *current_request) {
+  // a waiting request only enters the queue once something is dequeued, which an idle cycle never does.
+  // otherwise resume no later than the CPU cycle the next request arrives on.
+  // the dram only follows the wall clock with refresh on, so count from the clock
+  uint64_t next_dimm_cycle = dimm_cycle_at(*clock_cycle) + 1;
+  uint64_t max_cycles = UINT64_MAX;
+  if (current_request == NULL && parser->status == OK) {
+    uint64_t arrival = dimm_cycle_at(parser->next_request->time);
+    max_cycles = (arrival > next_dimm_cycle) ? arrival - next_dimm_cycle : 0;
+  }
+  uint64_t skipped_cycles = skip_idle_cycles(dimm, channel, global_queue, write_queue, max_cycles);
+  if (skipped_cycles > 0) {
+    LOG("All requests are waiting on timers. Skipping %" PRIu64 " DIMM cycles\n", skipped_cycles);
+    *clock_cycle = cpu_cycle_of(next_dimm_cycle + skipped_cycles) - 1;  // advance_clock moves on to the next DIMM cycle
+  }
+}
+
+MemoryRequest_t *first_bank_request(Queue_t *q, MemoryRequest_t *request, bool is_write, bool is_same_row) {
+  // the first request in queue order to the request's bank that is (or is not) a write to the
+  // same (or another) row. the bank's requests are all in its pending and started lists, so only
+  // those are walked and the earlier of the two first matches is taken
+  int bank = request->bank_group * NUM_BANKS_PER_GROUP + request->bank;
+  MemoryRequest_t *lists[2] = {queue_bank_pending(q, bank), queue_bank_started(q, bank)};
+  MemoryRequest_t *first = NULL;
+
+  for (int i = 0; i < 2; i++) {
+    for (MemoryRequest_t *other = lists[i]; other != NULL; other = queue_bank_next(q, other)) {
+      if ((other->operation == DATA_WRITE) == is_write && (other->row == request->row) == is_same_row) {
+        if (first == NULL || queue_is_ahead(q, other, first)) {
+          first = other;
+        }
+        break;
+      }
+    }
+  }
+  return first;
+}
+
+void out_of_order(Queue_t *global_queue, MemoryRequest_t *current_request) {
+  check_requests_age(global_queue);
+
+  bool inserted = false;  // flag so we dont insert it twice
+  MemoryRequest_t *position = NULL;
+
+  // this if else is for reads>writes when valid
+  if (current_request->operation == DATA_WRITE) {
+    position = first_bank_request(global_queue, current_request, false, false);
+    if (position != NULL) {
+      // we put DATA_WRITE after the DATA_READ or IFETCH
+      queue_insert_after(&global_queue, position, *current_request);
+      inserted = true;
+    }
+  } else {
+    position = first_bank_request(global_queue, current_request, true, false);
+    if (position != NULL) {
+      // we put the DATA_READ or IFETCH before the DATA_WRITE
+      queue_insert_before(&global_queue, position, *current_request);
+      inserted = true;
+    }
+  }
+  // if read > write is not valid, we want to prioritize hits.
+  // put the read after write so we dont read stale data
+  if (!inserted && current_request->operation != DATA_WRITE) {
+    position = first_bank_request(global_queue, current_request, true, true);
+    if (position != NULL) {
+      queue_insert_after(&global_queue, position, *current_request);
+      inserted = true;
+    }
+  }
+  // if read > write is not valid, we want to prioritize hits.
+  // put the read next to the other read
+  if (!inserted && current_request->operation != DATA_WRITE) {
+    position = first_bank_request(global_queue, current_request, false, true);
+    if (position != NULL) {
+      queue_insert_after(&global_queue, position, *current_request);
+      inserted = true;
+    }
+  }
+
+  // flag not up we do it normally
+  if (!inserted) {
+    enqueue(&global_queue, *current_request);
+  }
+}
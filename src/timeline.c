@@ -0,0 +1,222 @@
+/**
+ * @file  timeline.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "timeline.h"
+#include "dimm.h"
+
+#define TIMELINE_MAX_LINE 256
+#define TIMELINE_CSV_HEADER "channel,bank_group,bank,state,row,start,end\n"
+#define TIMELINE_JSON_HEADER "{\"traceEvents\":[\n"
+
+static const char *activity_names[NUM_BANK_ACTIVITIES] = {
+  "idle", "activating", "open", "reading", "writing", "precharging", "refreshing"
+};
+
+static size_t append(char *buffer, const char *text) {
+  size_t length = strlen(text);
+  memcpy(buffer, text, length);
+  return length;
+}
+
+static void write_interval(Timeline_t *timeline, int index, BankTimeline_t *state, uint64_t end) {
+  // idle is the default, so only the time a bank is doing something is written
+  if (state->activity == BANK_IDLE || end <= state->start) {
+    return;
+  }
+
+  bool has_row = state->activity != BANK_REFRESHING;
+  char *line = trace_writer_reserve(timeline->writer, TIMELINE_MAX_LINE);
+  size_t length = 0;
+
+  if (timeline->format == TIMELINE_JSON) {
+    length += append(line + length, "{\"name\":\"");
+    length += append(line + length, activity_names[state->activity]);
+    length += append(line + length, "\",\"ph\":\"X\",\"pid\":");
+    length += format_decimal(line + length, timeline->channel, 0);
+    length += append(line + length, ",\"tid\":");
+    length += format_decimal(line + length, index, 0);
+    length += append(line + length, ",\"ts\":");
+    length += format_decimal(line + length, state->start, 0);
+    length += append(line + length, ",\"dur\":");
+    length += format_decimal(line + length, end - state->start, 0);
+    if (has_row) {
+      length += append(line + length, ",\"args\":{\"row\":");
+      length += format_decimal(line + length, state->row, 0);
+      length += append(line + length, "}");
+    }
+    length += append(line + length, "},\n");
+  }
+  else {
+    length += format_decimal(line + length, timeline->channel, 0);
+    line[length++] = ',';
+    length += format_decimal(line + length, index / timeline->banks_per_group, 0);
+    line[length++] = ',';
+    length += format_decimal(line + length, index % timeline->banks_per_group, 0);
+    line[length++] = ',';
+    length += append(line + length, activity_names[state->activity]);
+    line[length++] = ',';
+    if (has_row) {
+      length += format_decimal(line + length, state->row, 0);
+    }
+    line[length++] = ',';
+    length += format_decimal(line + length, state->start, 0);
+    line[length++] = ',';
+    length += format_decimal(line + length, end, 0);
+    line[length++] = '\n';
+  }
+
+  trace_writer_commit(timeline->writer, length);
+}
+
+static void settle(Timeline_t *timeline, int index, uint64_t cycle) {
+  // a timed activity that ended before cycle is written, and the bank rests until cycle
+  BankTimeline_t *state = &timeline->banks[index];
+
+  if (state->activity == BANK_OPEN || state->activity == BANK_IDLE || state->busy_until > cycle) {
+    return;
+  }
+
+  write_interval(timeline, index, state, state->busy_until);
+  state->activity = (state->activity == BANK_PRECHARGING || state->activity == BANK_REFRESHING) ? BANK_IDLE : BANK_OPEN;
+  state->start = state->busy_until;
+}
+
+static void begin_activity(Timeline_t *timeline, int index, BankActivity_t activity, uint64_t cycle, uint64_t dimm_cycles) {
+  BankTimeline_t *state = &timeline->banks[index];
+
+  settle(timeline, index, cycle);
+  write_interval(timeline, index, state, cycle);
+  state->activity = activity;
+  state->start = cycle;
+  state->busy_until = cpu_cycle_of(dimm_cycle_at(cycle) + dimm_cycles);
+}
+
+TimelineFormat_t timeline_format_of(char *file_name) {
+  size_t length = strlen(file_name);
+  return (length >= 5 && strcmp(file_name + length - 5, ".json") == 0) ? TIMELINE_JSON : TIMELINE_CSV;
+}
+
+Timeline_t *timeline_open(TimelineFormat_t format, uint8_t channel, int bank_groups, int banks_per_group) {
+  Timeline_t *timeline = malloc(sizeof(Timeline_t));
+  if (timeline == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  timeline->bank_count = bank_groups * banks_per_group;
+  timeline->banks = calloc(timeline->bank_count, sizeof(BankTimeline_t));
+  if (timeline->banks == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  timeline->writer = trace_writer_open_temporary();
+  timeline->format = format;
+  timeline->channel = channel;
+  timeline->banks_per_group = banks_per_group;
+
+  // name the channel and its banks in the viewer
+  if (format == TIMELINE_JSON) {
+    char line[TIMELINE_MAX_LINE];
+    int length = snprintf(line, sizeof(line), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"Channel %u\"}},\n", channel, channel);
+    trace_writer_write(timeline->writer, line, length);
+
+    for (int i = 0; i < timeline->bank_count; i++) {
+      length = snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%d,\"args\":{\"name\":\"BG%d B%d\"}},\n", channel, i,
+                        i / banks_per_group, i % banks_per_group);
+      trace_writer_write(timeline->writer, line, length);
+    }
+  }
+
+  return timeline;
+}
+
+void timeline_record(Timeline_t *timeline, CommandCode_t cmd, uint8_t bank_group, uint8_t bank, uint16_t row, uint64_t cycle) {
+  int index = bank_group * timeline->banks_per_group + bank;
+
+  switch (cmd) {
+    case CMD_ACT0:
+      begin_activity(timeline, index, BANK_ACTIVATING, cycle, timing_profile.timing_attribute[tRCD]);
+      timeline->banks[index].row = row;
+      break;
+
+    case CMD_RD0:
+      begin_activity(timeline, index, BANK_READING, cycle, timing_profile.timing_attribute[tCL] + timing_profile.timing_attribute[tBURST]);
+      break;
+
+    case CMD_WR0:
+      begin_activity(timeline, index, BANK_WRITING, cycle, timing_profile.timing_attribute[tCWL] + timing_profile.timing_attribute[tBURST]);
+      break;
+
+    case CMD_PRE:
+      begin_activity(timeline, index, BANK_PRECHARGING, cycle, timing_profile.timing_attribute[tRP]);
+      break;
+
+    case CMD_REF:
+      for (int i = 0; i < timeline->bank_count; i++) {
+        begin_activity(timeline, i, BANK_REFRESHING, cycle, timing_profile.timing_attribute[tRFC]);
+      }
+      break;
+
+    case CMD_REFSB:
+      for (int i = bank; i < timeline->bank_count; i += timeline->banks_per_group) {
+        begin_activity(timeline, i, BANK_REFRESHING, cycle, timing_profile.tRFCsb);
+      }
+      break;
+
+    default:  // second halves of two-cycle commands change nothing
+      break;
+  }
+}
+
+void timeline_finish(Timeline_t *timeline, uint64_t cycle) {
+  for (int i = 0; i < timeline->bank_count; i++) {
+    BankTimeline_t *state = &timeline->banks[i];
+
+    settle(timeline, i, cycle);
+    write_interval(timeline, i, state, cycle);
+    state->activity = BANK_IDLE;
+    state->start = cycle;
+  }
+}
+
+void timeline_merge(char *file_name, Timeline_t **timelines, int count) {
+  TraceWriter_t *output = trace_writer_open(file_name);
+  TimelineFormat_t format = (count > 0) ? timelines[0]->format : TIMELINE_CSV;
+  char buffer[TRACE_WRITER_BUFFER_SIZE / 16];
+
+  if (format == TIMELINE_JSON) {
+    trace_writer_write(output, TIMELINE_JSON_HEADER, strlen(TIMELINE_JSON_HEADER));
+  }
+  else {
+    trace_writer_write(output, TIMELINE_CSV_HEADER, strlen(TIMELINE_CSV_HEADER));
+  }
+
+  // the intervals of each channel are copied as a block; viewers sort them by time
+  for (int i = 0; i < count; i++) {
+    TraceWriter_t *writer = timelines[i]->writer;
+    size_t length;
+
+    trace_writer_flush(writer);
+    rewind(writer->file);
+    while ((length = fread(buffer, 1, sizeof(buffer), writer->file)) > 0) {
+      trace_writer_write(output, buffer, length);
+    }
+
+    trace_writer_close(writer);
+    free(timelines[i]->banks);
+    free(timelines[i]);
+  }
+
+  if (format == TIMELINE_JSON) {
+    // every event above ends with a comma, so the list ends with one more
+    const char *footer = "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":0,\"args\":{\"sort_index\":0}}\n]}\n";
+    trace_writer_write(output, footer, strlen(footer));
+  }
+
+  trace_writer_close(output);
+}
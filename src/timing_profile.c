@@ -0,0 +1,184 @@
+/**
+ * @file  timing_profile.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <math.h>
+#include "timing_profile.h"
+
+#define PROFILE_LINE_MAX 256
+#define NUM_PROFILE_TIMINGS (NUM_TIMING_CONSTRAINTS + NUM_CONSECUTIVE_CMD_CONSTRAINTS + 3)
+
+TimingProfile_t timing_profile = {
+  .name = "DDR5-4800B",
+  .data_rate = DATA_RATE,
+  .timing_attribute = {
+    TRC,
+    TRAS,
+    TRP,
+    TRFC,
+    TCWL,
+    TCL,
+    TRCD,
+    TWR,
+    TRTP,
+    TBURST
+  },
+  .consecutive_cmd_attribute = {
+    TRRD_L,
+    TRRD_S,
+    TCCD_L,
+    TCCD_S,
+    TCCD_L_WR,
+    TCCD_S_WR,
+    TCCD_L_RTW,
+    TCCD_S_RTW,
+    TCCD_L_WTR,
+    TCCD_S_WTR
+  },
+  .tFAW = TFAW,
+  .tREFI = TREFI,
+  .tRFCsb = TRFCSB
+};
+
+// in the order of timing_attribute, then consecutive_cmd_attribute, then tFAW, tREFI and tRFCsb
+static const char *timing_names[NUM_PROFILE_TIMINGS] = {
+  "tRC", "tRAS", "tRP", "tRFC", "tCWL", "tCL", "tRCD", "tWR", "tRTP", "tBURST",
+  "tRRD_L", "tRRD_S", "tCCD_L", "tCCD_S", "tCCD_L_WR", "tCCD_S_WR", "tCCD_L_RTW", "tCCD_S_RTW", "tCCD_L_WTR", "tCCD_S_WTR",
+  "tFAW", "tREFI", "tRFCsb"
+};
+
+// a timing as written in the file; nanoseconds can only be converted once the data rate is known
+typedef struct ProfileTiming {
+  double value;
+  bool is_set;
+  bool is_nanoseconds;
+  int line;
+} ProfileTiming_t;
+
+static uint32_t *timing_field(TimingProfile_t *profile, int index) {
+  if (index < NUM_TIMING_CONSTRAINTS) {
+    return &profile->timing_attribute[index];
+  }
+  index -= NUM_TIMING_CONSTRAINTS;
+  if (index < NUM_CONSECUTIVE_CMD_CONSTRAINTS) {
+    return &profile->consecutive_cmd_attribute[index];
+  }
+  index -= NUM_CONSECUTIVE_CMD_CONSTRAINTS;
+  return (index == 0) ? &profile->tFAW : (index == 1) ? &profile->tREFI : &profile->tRFCsb;
+}
+
+static char *trim(char *text) {
+  while (isspace((unsigned char)*text)) {
+    text++;
+  }
+
+  char *end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1])) {
+    end--;
+  }
+  *end = '\0';
+
+  return text;
+}
+
+static void __attribute__((noreturn)) invalid_profile(char *file_name, int line, const char *message, const char *value) {
+  fprintf(stderr, "Error: %s:%d: %s: %s\n", file_name, line, message, value);
+  exit(EXIT_FAILURE);
+}
+
+void timing_profile_load(char *file_name) {
+  FILE *file = fopen(file_name, "r");
+  if (file == NULL) {
+    perror("Error opening timing profile");
+    exit(EXIT_FAILURE);
+  }
+
+  TimingProfile_t profile = timing_profile;
+  ProfileTiming_t timings[NUM_PROFILE_TIMINGS] = {0};
+  char buffer[PROFILE_LINE_MAX];
+  int line = 0;
+
+  while (fgets(buffer, sizeof(buffer), file) != NULL) {
+    line++;
+
+    char *comment = strchr(buffer, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    char *separator = strchr(buffer, '=');
+    if (separator == NULL) {
+      if (*trim(buffer) != '\0') {
+        invalid_profile(file_name, line, "expected key = value", trim(buffer));
+      }
+      continue;
+    }
+
+    *separator = '\0';
+    char *key = trim(buffer);
+    char *value = trim(separator + 1);
+    char *end;
+
+    if (strcmp(key, "name") == 0) {
+      snprintf(profile.name, sizeof(profile.name), "%s", value);
+      continue;
+    }
+
+    if (strcmp(key, "data_rate") == 0) {
+      unsigned long data_rate = strtoul(value, &end, 10);
+      if (*value == '\0' || *end != '\0' || data_rate == 0 || data_rate > 2 * CPU_CLOCK_MHZ || data_rate % 2 != 0) {
+        invalid_profile(file_name, line, "data rate must be an even number of MT/s up to twice the CPU clock", value);
+      }
+      profile.data_rate = data_rate;
+      continue;
+    }
+
+    int index = 0;
+    while (index < NUM_PROFILE_TIMINGS && strcmp(key, timing_names[index]) != 0) {
+      index++;
+    }
+    if (index == NUM_PROFILE_TIMINGS) {
+      invalid_profile(file_name, line, "unknown key", key);
+    }
+
+    ProfileTiming_t *timing = &timings[index];
+    timing->value = strtod(value, &end);
+    timing->is_nanoseconds = strcmp(end, "ns") == 0;
+    timing->is_set = true;
+    timing->line = line;
+    if (end == value || (*end != '\0' && !timing->is_nanoseconds) || !(timing->value > 0)) {
+      invalid_profile(file_name, line, "timing must be a positive number of cycles or ns", value);
+    }
+  }
+
+  fclose(file);
+
+  // one DIMM clock cycle lasts 2000 / data_rate ns
+  for (int i = 0; i < NUM_PROFILE_TIMINGS; i++) {
+    ProfileTiming_t *timing = &timings[i];
+    if (!timing->is_set) {
+      continue;
+    }
+
+    double cycles = timing->value;
+    if (timing->is_nanoseconds) {
+      cycles = ceil(timing->value * profile.data_rate / 2000.0 - 1e-9);
+    }
+    if (cycles != floor(cycles) || cycles < 1 || cycles > UINT32_MAX) {
+      char value[32];
+      snprintf(value, sizeof(value), "%g cycles", cycles);
+      invalid_profile(file_name, timing->line, "timing must be a whole number of cycles from 1 to 4294967295", value);
+    }
+    *timing_field(&profile, i) = cycles;
+  }
+
+  // a refresh has to end before the next one falls due
+  if (profile.timing_attribute[tRFC] >= profile.tREFI) {
+    invalid_profile(file_name, line, "tRFC must be shorter than tREFI", profile.name);
+  }
+
+  timing_profile = profile;
+}
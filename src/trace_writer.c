@@ -0,0 +1,137 @@
+/**
+ * @file  trace_writer.c
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <unistd.h>
+#include "trace_writer.h"
+
+static TraceWriter_t *trace_writer_create(FILE *file) {
+  TraceWriter_t *writer = malloc(sizeof(TraceWriter_t));
+
+  if (writer == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  writer->file = file;
+  writer->buffer = malloc(TRACE_WRITER_BUFFER_SIZE);
+  if (writer->buffer == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  writer->used = 0;
+
+  return writer;
+}
+
+TraceWriter_t *trace_writer_open(char *file_name) {
+  FILE *file = (strcmp(file_name, TRACE_WRITER_STDOUT) == 0) ? stdout : fopen(file_name, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "%s:%d: fopen failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  return trace_writer_create(file);
+}
+
+TraceWriter_t *trace_writer_open_temporary(void) {
+  FILE *file = tmpfile();
+  if (file == NULL) {
+    fprintf(stderr, "%s:%d: tmpfile failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  return trace_writer_create(file);
+}
+
+void trace_writer_close(TraceWriter_t *writer) {
+  if (writer != NULL) {
+    trace_writer_flush(writer);
+    fclose(writer->file);
+    free(writer->buffer);
+    free(writer);
+  }
+}
+
+void trace_writer_flush(TraceWriter_t *writer) {
+  if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+    fprintf(stderr, "%s:%d: fwrite failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  writer->used = 0;
+}
+
+void trace_writer_truncate(TraceWriter_t *writer) {
+  writer->used = 0;
+  if (fseek(writer->file, 0, SEEK_SET) != 0 || ftruncate(fileno(writer->file), 0) != 0) {
+    fprintf(stderr, "%s:%d: truncating the output failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+}
+
+char *trace_writer_reserve(TraceWriter_t *writer, size_t length) {
+  if (writer->used + length > TRACE_WRITER_BUFFER_SIZE) {
+    trace_writer_flush(writer);
+  }
+
+  return writer->buffer + writer->used;
+}
+
+void trace_writer_commit(TraceWriter_t *writer, size_t length) {
+  writer->used += length;
+}
+
+void trace_writer_write(TraceWriter_t *writer, const void *data, size_t length) {
+  // records bigger than the buffer bypass it
+  if (length > TRACE_WRITER_BUFFER_SIZE) {
+    trace_writer_flush(writer);
+    if (fwrite(data, 1, length, writer->file) != length) {
+      fprintf(stderr, "%s:%d: fwrite failed\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
+  memcpy(trace_writer_reserve(writer, length), data, length);
+  trace_writer_commit(writer, length);
+}
+
+size_t format_decimal(char *buffer, uint64_t value, int width) {
+  char digits[20];
+  int length = 0;
+
+  do {
+    digits[length++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+
+  int padding = (width > length) ? width - length : 0;
+  memset(buffer, ' ', padding);
+
+  for (int i = 0; i < length; i++) {
+    buffer[padding + i] = digits[length - 1 - i];
+  }
+
+  return padding + length;
+}
+
+size_t format_hex(char *buffer, uint64_t value, int digits) {
+  static const char hex_digits[] = "0123456789ABCDEF";
+
+  // widen the field if the value does not fit, like printf does
+  while (digits < 16 && (value >> (4 * digits)) != 0) {
+    digits++;
+  }
+
+  for (int i = digits - 1; i >= 0; i--) {
+    buffer[i] = hex_digits[value & 0xF];
+    value >>= 4;
+  }
+
+  return digits;
+}
@@ -3,12 +3,16 @@
  * ECE585 Team 5
  *
  * Used to generate a trace file for test case use
+ *
+ * Addresses are encoded with the simulator's address mapping, so build from the repository root with
+ *   gcc -Iinclude tests/Test_Case_Creation/trace_script.c src/memory_request.c -o trace_script
 */
 
 // Includes and Defines
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "memory_request.h"
 
 #define DEFAULT_FILE_NAME "trace.txt"
 #define STRING_MAX 256
@@ -44,6 +48,17 @@ int main() {
     printf("the trace file name is: %s\n", trace_name);
     #endif
 
+    // Ask for the address mapping the simulator will be run with
+    char mapping_name[STRING_MAX] = "default";
+    AddressMapping_t mapping;
+    printf("Enter address mapping (default, xor, row or line)\n");
+    scanf("%s", mapping_name);
+    if (!address_mapping_from_name(mapping_name, &mapping)) {
+        printf("Unknown address mapping: %s\n", mapping_name);
+        exit(1);
+    }
+    set_address_mapping(mapping);
+
     if((fp = fopen(trace_name, "w")) == NULL) {
         printf("Error opening or creating file\n");
         exit(1);
@@ -157,6 +172,7 @@ void obtaining_line (
 /**
  * @brief Write the values in val[] as a line into trace file in format
  *        time, core, operation, address
+ *        the address is encoded with the selected address mapping, which for the default mapping is
  *        address = row[33:18], col_h[17:12], BA[11:10], BG[9:7], channel[6], col_l[5:2], offset[1:0]
  * @param val array containing: (0)time, (1)core, (2)operation, (3)bank, (4)bank_group, (5)row, (6)column
  * @param fp file pointer to trace file
@@ -165,31 +181,15 @@ void writing_line (
     int val[], 
     FILE *fp
 ) {
-    unsigned int col_h, col_l;
-    // Doing this for clarity on what the operations are working with
-    unsigned int row = val[5], BA = val[3], BG = val[4];
-    unsigned long long int address = 0x0;
-
-    col_h = get_value(val[6], 4, 9);
-    col_l = get_value(val[6], 0, 3);
-
-    address = set_value(address, 18, 33, row);
-    #ifdef DEBUG
-        printf("setted row: %X\n", address);
-    #endif
-    address = set_value(address, 12, 17, col_h);
-    #ifdef DEBUG
-        printf("setted col_h: %X\n", address);
-    #endif
-    address = set_value(address, 10, 11, BA);
-    #ifdef DEBUG
-        printf("setted BG: %X\n", address);
-    #endif
-    address = set_value(address, 7, 9, BG);
-    // Bit 6 is the channel bit, and we will only be working in channel 0
-    address = set_value(address, 2, 5, col_l);
+    MemoryRequest_t request = {0};
+
+    request.row = val[5];
+    request.column_high = get_value(val[6], 4, 9);
+    request.bank = val[3];
+    request.bank_group = val[4];
+    // The channel bit stays 0, we will only be working in channel 0
+    request.column_low = get_value(val[6], 0, 3);
     // Bit 0 and 1 are the offset which should stay 0
 
-    fprintf(fp, "%d %d %d %llX\n", val[0], val[1], val[2], address);
+    fprintf(fp, "%d %d %d %09llX\n", val[0], val[1], val[2], (unsigned long long)get_address(&request));
 }
-
@@ -0,0 +1,241 @@
+/**
+ * @file    batch_runner.c
+ *
+ * @brief   Sweeps every combination of trace file, scheduling policy and queue
+ *          size across a pool of worker threads and writes one summary line per
+ *          simulation. Each simulation owns its parser, queue and DIMM, so the
+ *          workers share nothing but the job counter.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <getopt.h>
+#include <libgen.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "queue.h"
+#include "simulation.h"
+
+#define MAX_LIST_LENGTH 64
+#define DISCARD_OUTPUT_FILE "/dev/null"
+
+typedef struct Job {
+  char *input_file;
+  int scheduling_policy;
+  uint64_t queue_size;
+  char output_file[PATH_MAX];
+  SimulationResult_t result;
+  double seconds;
+} Job_t;
+
+typedef struct BatchRunner {
+  Job_t *jobs;
+  size_t job_count;
+  atomic_size_t next_job;
+  bool fast_forward;
+  RefreshMode_t refresh_mode;
+} BatchRunner_t;
+
+void *worker(void *arg);
+size_t parse_list(char *list, uint64_t *values, uint64_t min_value, uint64_t max_value, const char *name);
+void usage(char *program);
+
+int main(int argc, char *argv[]) {
+  uint64_t policies[MAX_LIST_LENGTH] = {LEVEL_0, LEVEL_1, LEVEL_2, LEVEL_3, LEVEL_4, LEVEL_5};
+  uint64_t queue_sizes[MAX_LIST_LENGTH] = {16};
+  size_t policy_count = 6, queue_size_count = 1;
+  long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  char *summary_file_name = NULL;
+  char *output_dir = NULL;
+  BatchRunner_t runner = {.fast_forward = false, .refresh_mode = REFRESH_OFF};
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:q:j:o:d:r:M:p:fh")) != -1) {
+    switch (opt) {
+      case 's':  // Comma separated scheduling policies
+        policy_count = parse_list(optarg, policies, LEVEL_0, LEVEL_5, "scheduling policy");
+        break;
+      case 'q':  // Comma separated queue sizes
+        queue_size_count = parse_list(optarg, queue_sizes, 1, QUEUE_MAX_CAPACITY, "queue size");
+        break;
+      case 'j':  // Worker threads
+        thread_count = atol(optarg);
+        if (thread_count < 1) {
+          fprintf(stderr, "Invalid thread count: %s. Must be at least 1.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'o':  // Summary file
+        summary_file_name = optarg;
+        break;
+      case 'd':  // Directory for the DRAM command outputs
+        output_dir = optarg;
+        break;
+      case 'r':  // Refresh mode
+        runner.refresh_mode = atoi(optarg);
+        if (runner.refresh_mode < REFRESH_OFF || runner.refresh_mode > REFRESH_SAME_BANK) {
+          fprintf(stderr, "Invalid refresh mode: %s. Must be between 0 and 2.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'M': {  // Address mapping, shared by every run
+        AddressMapping_t address_mapping;
+        if (!address_mapping_from_name(optarg, &address_mapping)) {
+          fprintf(stderr, "Invalid address mapping: %s. Must be default, xor, row or line.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        set_address_mapping(address_mapping);
+        break;
+      }
+      case 'p':  // Timing profile, shared by every run
+        timing_profile_load(optarg);
+        break;
+      case 'f':  // Fast-forward idle DIMM cycles
+        runner.fast_forward = true;
+        break;
+      case 'h':
+      case '?':
+        usage(argv[0]);
+    }
+  }
+
+  size_t trace_count = argc - optind;
+  if (trace_count == 0) {
+    usage(argv[0]);
+  }
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+
+  runner.job_count = trace_count * policy_count * queue_size_count;
+  runner.jobs = calloc(runner.job_count, sizeof(Job_t));
+  if (runner.jobs == NULL) {
+    fprintf(stderr, "Error: Memory allocation for batch jobs failed.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  size_t j = 0;
+  for (size_t t = 0; t < trace_count; t++) {
+    for (size_t p = 0; p < policy_count; p++) {
+      for (size_t q = 0; q < queue_size_count; q++, j++) {
+        Job_t *job = &runner.jobs[j];
+        job->input_file = argv[optind + t];
+        job->scheduling_policy = policies[p];
+        job->queue_size = queue_sizes[q];
+        if (output_dir == NULL) {
+          strcpy(job->output_file, DISCARD_OUTPUT_FILE);
+        } else {
+          char trace_name[PATH_MAX];
+          snprintf(trace_name, sizeof(trace_name), "%s", job->input_file);
+          snprintf(job->output_file, sizeof(job->output_file), "%s/%s.s%d.q%" PRIu64 ".txt", output_dir,
+                   basename(trace_name), job->scheduling_policy, job->queue_size);
+        }
+      }
+    }
+  }
+  atomic_init(&runner.next_job, 0);
+
+  if ((size_t)thread_count > runner.job_count) {
+    thread_count = runner.job_count;
+  }
+  pthread_t *threads = malloc(thread_count * sizeof(pthread_t));
+  if (threads == NULL) {
+    fprintf(stderr, "Error: Memory allocation for worker threads failed.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (long i = 0; i < thread_count; i++) {
+    if (pthread_create(&threads[i], NULL, worker, &runner) != 0) {
+      fprintf(stderr, "Error: Could not start worker thread.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (long i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+
+  FILE *summary = stdout;
+  if (summary_file_name != NULL && (summary = fopen(summary_file_name, "w")) == NULL) {
+    fprintf(stderr, "Error: Could not open summary file %s.\n", summary_file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  // jobs are written in sweep order no matter which thread finished first
+  fprintf(summary, "trace,policy,queue_size,requests,total_cycles,seconds\n");
+  for (size_t i = 0; i < runner.job_count; i++) {
+    Job_t *job = &runner.jobs[i];
+    fprintf(summary, "%s,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.6f\n", job->input_file, job->scheduling_policy,
+            job->queue_size, job->result.request_count, job->result.total_cycles, job->seconds);
+  }
+
+  if (summary != stdout) {
+    fclose(summary);
+  }
+  free(runner.jobs);
+  return 0;
+}
+
+void *worker(void *arg) {
+  BatchRunner_t *runner = arg;
+
+  while (true) {
+    size_t i = atomic_fetch_add(&runner->next_job, 1);
+    if (i >= runner->job_count) {
+      break;
+    }
+
+    Job_t *job = &runner->jobs[i];
+    SimulationConfig_t config = {
+      .input_file = job->input_file,
+      .output_file = job->output_file,
+      .scheduling_policy = job->scheduling_policy,
+      .queue_size = job->queue_size,
+      .fast_forward = runner->fast_forward,
+      .output_format = TEXT_FORMAT,
+      .refresh_mode = runner->refresh_mode
+    };
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    simulate(&config, &job->result);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    job->seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+  }
+
+  return NULL;
+}
+
+size_t parse_list(char *list, uint64_t *values, uint64_t min_value, uint64_t max_value, const char *name) {
+  size_t count = 0;
+
+  for (char *token = strtok(list, ","); token != NULL; token = strtok(NULL, ",")) {
+    char *end;
+    uint64_t value = strtoull(token, &end, 10);
+    if (*token == '\0' || *end != '\0' || value < min_value || value > max_value) {
+      fprintf(stderr, "Invalid %s: %s.\n", name, token);
+      exit(EXIT_FAILURE);
+    }
+    if (count == MAX_LIST_LENGTH) {
+      fprintf(stderr, "Too many values for %s. At most %d are allowed.\n", name, MAX_LIST_LENGTH);
+      exit(EXIT_FAILURE);
+    }
+    values[count++] = value;
+  }
+
+  if (count == 0) {
+    fprintf(stderr, "Invalid %s list: %s.\n", name, list);
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
+
+void usage(char *program) {
+  fprintf(stderr, "Usage: %s [-s policies] [-q queue_sizes] [-j threads] [-o summary_file] [-d output_dir] [-r refresh_mode] [-M address_mapping] [-p timing_profile] [-f] trace_file...\n",
+          program);
+  exit(EXIT_FAILURE);
+}
@@ -0,0 +1,414 @@
+/**
+ * @file    bench.c
+ *
+ * @brief   Microbenchmarks for the simulator's hot paths and end-to-end runs on
+ *          synthetic traces. Each microbenchmark is repeated with more iterations
+ *          until it runs for at least the minimum time, like Google Benchmark, and
+ *          the results are written as Google Benchmark style JSON.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <getopt.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include "dimm.h"
+#include "parser.h"
+#include "queue.h"
+#include "simulation.h"
+#include "trace_writer.h"
+
+#define DEFAULT_MIN_TIME 0.5       // seconds each microbenchmark runs for at least
+#define DEFAULT_POLICY LEVEL_4     // scheduling policy of the end-to-end runs
+#define BENCH_QUEUE_SIZE 16
+#define BENCH_LINES 4096           // distinct trace lines parse_line cycles through
+#define BENCH_LINE_LENGTH 32
+#define BENCH_ROWS 64              // rows the synthetic requests spread over, for some row hits
+#define BENCH_ARRIVAL_INTERVAL 20  // CPU clock cycles between synthetic requests
+#define BENCH_COMMANDS_PER_BATCH (TRACE_WRITER_BUFFER_SIZE / sizeof(CommandRecord_t))  // issue_cmd records between truncations
+#define BENCH_CYCLES_PER_BATCH 64  // DIMM cycles process_request runs between refills of the queue
+#define BENCH_TRACE_TEMPLATE "/tmp/bench_trace_XXXXXX"
+
+typedef struct Timer {
+  struct timespec real_start;
+  struct timespec cpu_start;
+  double real_ns;  // summed over every timer_start / timer_stop pair
+  double cpu_ns;
+} Timer_t;
+
+// a microbenchmark runs the measured operation iterations times between timer_start and timer_stop,
+// stopping the timer for any setup it needs in between
+typedef void (*BenchmarkFunction_t)(uint64_t iterations, Timer_t *timer);
+
+/*** function prototype(s) ***/
+void run_benchmark(FILE *output, const char *name, BenchmarkFunction_t run, double min_time, bool *is_first);
+void run_end_to_end(FILE *output, uint64_t request_count, int scheduling_policy, bool *is_first);
+void write_synthetic_trace(char *file_name, uint64_t request_count);
+
+/*** state shared with the benchmark functions ***/
+static volatile uint64_t sink;  // results are added here so the compiler keeps the measured code
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+static int process_request_policy;
+
+/*** helper function(s) ***/
+static uint64_t next_random(void) {
+  // xorshift64*
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return random_state * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t random_address(void) {
+  // cache-line aligned, with rows limited to BENCH_ROWS so banks see row hits
+  uint64_t row = next_random() % BENCH_ROWS;
+  return (row << 18) | (next_random() & ((1 << 18) - 1) & ~(uint64_t)(CACHE_LINE_SIZE - 1));
+}
+
+static void random_request(MemoryRequest_t *request, uint64_t time) {
+  memory_request_init(request, time, next_random() % 12, next_random() % 3, random_address());
+}
+
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void timer_start(Timer_t *timer) {
+  clock_gettime(CLOCK_MONOTONIC, &timer->real_start);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &timer->cpu_start);
+}
+
+static void timer_stop(Timer_t *timer) {
+  struct timespec real_end, cpu_end;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+  clock_gettime(CLOCK_MONOTONIC, &real_end);
+  timer->real_ns += elapsed_ns(&timer->real_start, &real_end);
+  timer->cpu_ns += elapsed_ns(&timer->cpu_start, &cpu_end);
+}
+
+/*** benchmark(s) ***/
+static void bench_parse_line(uint64_t iterations, Timer_t *timer) {
+  static char lines[BENCH_LINES][BENCH_LINE_LENGTH];
+  static size_t lengths[BENCH_LINES];
+  MemoryRequest_t request;
+
+  for (int i = 0; i < BENCH_LINES; i++) {
+    lengths[i] = snprintf(lines[i], BENCH_LINE_LENGTH, "%d %d %d %09" PRIX64 "\n", i * 10, i % 12, i % 3, random_address());
+  }
+
+  timer_start(timer);
+  for (uint64_t i = 0; i < iterations; i++) {
+    char *line = lines[i % BENCH_LINES];
+    parse_line(line, line + lengths[i % BENCH_LINES], &request);
+    sink += request.row;
+  }
+  timer_stop(timer);
+}
+
+static void bench_memory_request_init(uint64_t iterations, Timer_t *timer) {
+  static uint64_t addresses[BENCH_LINES];
+  MemoryRequest_t request;
+
+  for (int i = 0; i < BENCH_LINES; i++) {
+    addresses[i] = random_address();
+  }
+
+  timer_start(timer);
+  for (uint64_t i = 0; i < iterations; i++) {
+    memory_request_init(&request, i, i % 12, i % 3, addresses[i % BENCH_LINES]);
+    sink += request.bank;
+  }
+  timer_stop(timer);
+}
+
+static Queue_t *full_queue(void) {
+  Queue_t *q = NULL;
+  MemoryRequest_t request;
+
+  queue_create(&q, BENCH_QUEUE_SIZE);
+  for (int i = 0; i < BENCH_QUEUE_SIZE; i++) {
+    random_request(&request, i);
+    enqueue(&q, request);
+  }
+  return q;
+}
+
+static void bench_enqueue_dequeue(uint64_t iterations, Timer_t *timer) {
+  Queue_t *q = full_queue();
+
+  timer_start(timer);
+  for (uint64_t i = 0; i < iterations; i++) {
+    MemoryRequest_t request = dequeue(&q);
+    enqueue(&q, request);
+  }
+  timer_stop(timer);
+
+  sink += queue_peek(q)->time;
+  queue_destroy(&q);
+}
+
+static void bench_queue_remove(uint64_t iterations, Timer_t *timer) {
+  // removes a request by its pointer and puts it back at the end, where it reuses the freed slot
+  Queue_t *q = full_queue();
+  MemoryRequest_t *requests[BENCH_QUEUE_SIZE];
+
+  int count = 0;
+  for (MemoryRequest_t *request = queue_peek(q); request != NULL; request = queue_next(q, request)) {
+    requests[count++] = request;
+  }
+
+  timer_start(timer);
+  for (uint64_t i = 0; i < iterations; i++) {
+    MemoryRequest_t request = queue_remove(&q, requests[(i * 7) % BENCH_QUEUE_SIZE]);
+    enqueue(&q, request);
+  }
+  timer_stop(timer);
+
+  sink += queue_peek(q)->time;
+  queue_destroy(&q);
+}
+
+static void bench_issue_cmd(uint64_t iterations, Timer_t *timer) {
+  static const CommandCode_t commands[] = {CMD_ACT0, CMD_ACT1, CMD_RD0, CMD_RD1, CMD_WR0, CMD_WR1, CMD_PRE};
+  DIMM_t *dimm = NULL;
+  MemoryRequest_t request;
+
+  dimm_create(&dimm, "/dev/null", BINARY_FORMAT, REFRESH_OFF, NULL, false);
+  random_request(&request, 0);
+
+  // the channel's temporary trace is emptied between batches, so it stays at one buffer's worth
+  for (uint64_t i = 0; i < iterations;) {
+    uint64_t batch_end = (iterations - i > BENCH_COMMANDS_PER_BATCH) ? i + BENCH_COMMANDS_PER_BATCH : iterations;
+
+    timer_start(timer);
+    for (; i < batch_end; i++) {
+      issue_cmd(&dimm->channels[0], commands[i % (sizeof(commands) / sizeof(commands[0]))], &request, i);
+    }
+    timer_stop(timer);
+
+    sink += dimm->channels[0].commands->record_count;
+    command_trace_truncate(dimm->channels[0].commands);
+  }
+
+  dimm_destroy(&dimm);
+}
+
+static void bench_process_request(uint64_t iterations, Timer_t *timer) {
+  // one DIMM cycle, in batches on a queue that is topped up (untimed) before each batch
+  DIMM_t *dimm = NULL;
+  Queue_t *q = NULL;
+  MemoryRequest_t request;
+  uint64_t clock = 0;
+
+  dimm_create(&dimm, "/dev/null", BINARY_FORMAT, REFRESH_OFF, NULL, false);
+  queue_create(&q, BENCH_QUEUE_SIZE);
+
+  for (uint64_t i = 0; i < iterations;) {
+    uint64_t batch_end = (iterations - i > BENCH_CYCLES_PER_BATCH) ? i + BENCH_CYCLES_PER_BATCH : iterations;
+
+    while (!queue_is_full(q)) {
+      random_request(&request, clock);
+      request.channel = 0;
+      enqueue(&q, request);
+    }
+    sink += dimm->channels[0].commands->record_count;
+    command_trace_truncate(dimm->channels[0].commands);
+
+    timer_start(timer);
+    for (; i < batch_end; i++) {
+      process_request(&dimm, 0, &q, NULL, clock, process_request_policy);
+      increment_aging_in_queue(q);
+      clock += 2;
+    }
+    timer_stop(timer);
+  }
+
+  queue_destroy(&q);
+  dimm_destroy(&dimm);
+}
+
+/*** function(s) ***/
+int main(int argc, char *argv[]) {
+  char *output_file_name = NULL;
+  double min_time = DEFAULT_MIN_TIME;
+  int scheduling_policy = DEFAULT_POLICY;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:m:s:h")) != -1) {
+    switch (opt) {
+      case 'o':  // JSON results
+        output_file_name = optarg;
+        break;
+      case 'm':  // Minimum time per microbenchmark
+        min_time = atof(optarg);
+        if (min_time <= 0) {
+          fprintf(stderr, "Invalid minimum time: %s. Must be greater than 0.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 's':  // Scheduling policy of the end-to-end runs
+        scheduling_policy = atoi(optarg);
+        if (scheduling_policy < LEVEL_0 || scheduling_policy > LEVEL_5) {
+          fprintf(stderr, "Invalid scheduling policy: %s. Must be between 0 and 5.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'h':
+      case '?':
+        fprintf(stderr, "Usage: %s [-o output_file] [-m min_time] [-s scheduling_policy] [request_count...]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  FILE *output = stdout;
+  if (output_file_name != NULL) {
+    output = fopen(output_file_name, "w");
+    if (output == NULL) {
+      fprintf(stderr, "Error: Could not open %s.\n", output_file_name);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  time_t now = time(NULL);
+  char date[32];
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(output, "{\n  \"context\": {\n");
+  fprintf(output, "    \"date\": \"%s\",\n", date);
+  fprintf(output, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+  fprintf(output, "    \"min_time\": %.3f,\n", min_time);
+  fprintf(output, "    \"library_build_type\": \"release\"\n");
+  fprintf(output, "  },\n  \"benchmarks\": [");
+
+  bool is_first = true;
+  run_benchmark(output, "parse_line", bench_parse_line, min_time, &is_first);
+  run_benchmark(output, "memory_request_init", bench_memory_request_init, min_time, &is_first);
+  run_benchmark(output, "enqueue_dequeue", bench_enqueue_dequeue, min_time, &is_first);
+  run_benchmark(output, "queue_remove", bench_queue_remove, min_time, &is_first);
+  run_benchmark(output, "issue_cmd", bench_issue_cmd, min_time, &is_first);
+  for (int level = LEVEL_0; level <= LEVEL_5; level++) {
+    char name[64];
+    snprintf(name, sizeof(name), "process_request/%d", level);
+    process_request_policy = level;
+    run_benchmark(output, name, bench_process_request, min_time, &is_first);
+  }
+
+  for (int i = optind; i < argc; i++) {
+    run_end_to_end(output, strtoull(argv[i], NULL, 10), scheduling_policy, &is_first);
+  }
+
+  fprintf(output, "\n  ]\n}\n");
+  if (output != stdout) {
+    fclose(output);
+  }
+  return 0;
+}
+
+void run_benchmark(FILE *output, const char *name, BenchmarkFunction_t run, double min_time, bool *is_first) {
+  // grow the iterations until a run takes at least min_time, aiming a little past it
+  uint64_t iterations = 1;
+  Timer_t timer;
+
+  while (true) {
+    timer = (Timer_t){0};
+    run(iterations, &timer);
+    if (timer.real_ns >= min_time * 1e9 || iterations >= UINT64_MAX / 10) {
+      break;
+    }
+
+    double scale = (timer.real_ns > 0) ? min_time * 1e9 * 1.4 / timer.real_ns : 10;
+    if (scale > 10) {
+      scale = 10;
+    }
+    if (scale < 2) {
+      scale = 2;
+    }
+    iterations = (uint64_t)(iterations * scale);
+  }
+
+  fprintf(output, "%s\n    {\n", *is_first ? "" : ",");
+  fprintf(output, "      \"name\": \"BM_%s\",\n", name);
+  fprintf(output, "      \"run_type\": \"iteration\",\n");
+  fprintf(output, "      \"iterations\": %" PRIu64 ",\n", iterations);
+  fprintf(output, "      \"real_time\": %.3f,\n", timer.real_ns / iterations);
+  fprintf(output, "      \"cpu_time\": %.3f,\n", timer.cpu_ns / iterations);
+  fprintf(output, "      \"time_unit\": \"ns\"\n");
+  fprintf(output, "    }");
+  fflush(output);
+  *is_first = false;
+}
+
+void run_end_to_end(FILE *output, uint64_t request_count, int scheduling_policy, bool *is_first) {
+  char trace_file[] = BENCH_TRACE_TEMPLATE;
+  int fd = mkstemp(trace_file);
+  if (fd < 0) {
+    fprintf(stderr, "Error: Could not create a temporary trace.\n");
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+
+  write_synthetic_trace(trace_file, request_count);
+
+  SimulationConfig_t config = {
+    .input_file = trace_file,
+    .output_file = "/dev/null",
+    .scheduling_policy = scheduling_policy,
+    .queue_size = BENCH_QUEUE_SIZE,
+    .fast_forward = true,
+    .output_format = BINARY_FORMAT,
+    .refresh_mode = REFRESH_OFF
+  };
+  SimulationResult_t *result = malloc(sizeof(SimulationResult_t));
+  if (result == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  Timer_t timer;
+  timer_start(&timer);
+  simulate(&config, result);
+  timer_stop(&timer);
+  unlink(trace_file);
+
+  fprintf(output, "%s\n    {\n", *is_first ? "" : ",");
+  fprintf(output, "      \"name\": \"BM_end_to_end/%" PRIu64 "\",\n", request_count);
+  fprintf(output, "      \"run_type\": \"iteration\",\n");
+  fprintf(output, "      \"iterations\": 1,\n");
+  fprintf(output, "      \"real_time\": %.3f,\n", timer.real_ns / 1e6);
+  fprintf(output, "      \"cpu_time\": %.3f,\n", timer.cpu_ns / 1e6);
+  fprintf(output, "      \"time_unit\": \"ms\",\n");
+  fprintf(output, "      \"scheduling_policy\": %d,\n", scheduling_policy);
+  fprintf(output, "      \"simulated_cycles\": %" PRIu64 ",\n", result->total_cycles);
+  fprintf(output, "      \"requests_per_second\": %.1f\n", result->request_count / (timer.real_ns / 1e9));
+  fprintf(output, "    }");
+  fflush(output);
+  *is_first = false;
+
+  free(result);
+}
+
+void write_synthetic_trace(char *file_name, uint64_t request_count) {
+  // uniform random requests arriving at a fixed rate, as a binary trace
+  TraceWriter_t *writer = trace_writer_open(file_name);
+  TraceHeader_t header = {0};
+
+  memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  header.version = TRACE_VERSION;
+  header.record_size = sizeof(TraceRecord_t);
+  header.record_count = request_count;
+  trace_writer_write(writer, &header, sizeof(header));
+
+  for (uint64_t i = 0; i < request_count; i++) {
+    TraceRecord_t record = {
+      .time = i * BENCH_ARRIVAL_INTERVAL,
+      .address = random_address(),
+      .core = next_random() % 12,
+      .operation = next_random() % 3
+    };
+    trace_writer_write(writer, &record, sizeof(record));
+  }
+
+  trace_writer_close(writer);
+}
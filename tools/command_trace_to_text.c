@@ -0,0 +1,89 @@
+/**
+ * @file    command_trace_to_text.c
+ *
+ * @brief   Converts a binary command trace (./bin/main -b) into the text format
+ *          the simulator writes to dram.txt
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <getopt.h>
+#include "command_trace.h"
+
+#define DEFAULT_OUTPUT_FILE "dram.txt"
+#define RECORDS_PER_READ 4096
+
+int main(int argc, char *argv[]) {
+  char *input_file_name = NULL;
+  char *output_file_name = DEFAULT_OUTPUT_FILE;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:o:h")) != -1) {
+    switch (opt) {
+      case 'i':  // Binary command trace
+        input_file_name = optarg;
+        break;
+      case 'o':  // Text output file
+        output_file_name = optarg;
+        break;
+      case 'h':
+      case '?':
+        fprintf(stderr, "Usage: %s -i binary_trace [-o output_file]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (input_file_name == NULL) {
+    fprintf(stderr, "Usage: %s -i binary_trace [-o output_file]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  FILE *input_file = fopen(input_file_name, "rb");
+  if (input_file == NULL) {
+    perror("Error opening file");
+    exit(EXIT_FAILURE);
+  }
+
+  CommandTraceHeader_t header;
+  if (
+    fread(&header, sizeof(header), 1, input_file) != 1 ||
+    memcmp(header.magic, COMMAND_TRACE_MAGIC, sizeof(COMMAND_TRACE_MAGIC)) != 0
+  ) {
+    fprintf(stderr, "Error: %s is not a binary command trace\n", input_file_name);
+    exit(EXIT_FAILURE);
+  }
+
+  if (header.version != COMMAND_TRACE_VERSION || header.record_size != sizeof(CommandRecord_t)) {
+    fprintf(stderr, "Error: unsupported command trace version %u (record size %u)\n", header.version, header.record_size);
+    exit(EXIT_FAILURE);
+  }
+
+  TraceWriter_t *writer = trace_writer_open(output_file_name);
+  CommandRecord_t *records = malloc(RECORDS_PER_READ * sizeof(CommandRecord_t));
+  if (records == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t record_count = 0;
+  size_t records_read;
+
+  while ((records_read = fread(records, sizeof(CommandRecord_t), RECORDS_PER_READ, input_file)) > 0) {
+    for (size_t i = 0; i < records_read; i++) {
+      char *line = trace_writer_reserve(writer, COMMAND_LINE_LENGTH);
+      trace_writer_commit(writer, command_record_to_text(&records[i], line));
+    }
+    record_count += records_read;
+  }
+
+  if (record_count != header.record_count) {
+    fprintf(stderr, "Error: expected %" PRIu64 " commands but found %" PRIu64 " (truncated trace?)\n", header.record_count, record_count);
+    exit(EXIT_FAILURE);
+  }
+
+  free(records);
+  trace_writer_close(writer);
+  fclose(input_file);
+  return 0;
+}
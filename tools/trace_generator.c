@@ -0,0 +1,377 @@
+/**
+ * @file    trace_generator.c
+ *
+ * @brief   Generates synthetic traces from workload parameters instead of hand
+ *          entered lines. Every core issues requests at its own mean arrival
+ *          interval, keeps accessing its current row with a given probability and
+ *          otherwise opens a new row in a bank chosen with a Zipf-like skew. The
+ *          same seed always gives the same trace, and the trace is streamed as
+ *          text or binary so it can hold billions of requests.
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include "dimm.h"
+#include "parser.h"
+#include "trace_writer.h"
+
+#define DEFAULT_OUTPUT_FILE TRACE_WRITER_STDOUT
+#define DEFAULT_CORES 4
+#define DEFAULT_INTERVAL 100   // mean CPU clock cycles between two requests of a core
+#define DEFAULT_LOCALITY 0.5
+#define DEFAULT_STRIDE CACHE_LINE_SIZE
+#define DEFAULT_SEED 1
+#define NUM_ROWS (1 << 16)
+#define ADDRESS_SPACE ((uint64_t)NUM_ROWS << 18)  // 16 GB; the row is the top field in every mapping
+#define LINES_PER_ROW (1 << 6)  // cache lines in a row: column[9:4]
+#define NUM_TARGETS (NUM_CHANNELS * NUM_BANKS)
+#define MAX_LINE_LENGTH 48
+
+typedef enum AccessPattern {
+  PATTERN_STRIDE,  // walk the physical addresses stride bytes at a time from the start of a row
+  PATTERN_RANDOM   // random cache line in the row, random row
+} AccessPattern_t;
+
+// where a core's requests currently go
+typedef struct CoreStream {
+  double interval;        // mean CPU clock cycles between requests
+  uint64_t next_time;     // arrival of the core's next request
+  MemoryRequest_t target; // channel, bank group, bank, row and column of the last request
+  uint64_t address;       // physical address of the last request
+  uint16_t next_row;      // row the core opens next with PATTERN_STRIDE
+  bool is_started;
+} CoreStream_t;
+
+typedef struct Generator {
+  int core_count;
+  CoreStream_t cores[NUM_CORES];
+  uint32_t operation_weights[NUM_OPERATIONS];
+  uint32_t operation_total;
+  double locality;
+  AccessPattern_t pattern;
+  uint64_t stride_lines;
+  double target_cdf[NUM_TARGETS];  // cumulative bank weights, in address order
+  uint64_t random_state;
+} Generator_t;
+
+/*** function prototype(s) ***/
+void generator_init(Generator_t *generator, double *intervals, int interval_count, double bank_skew, uint64_t seed);
+void generate_request(Generator_t *generator, TraceRecord_t *record);
+void usage(char *program);
+
+/*** helper function(s) ***/
+static uint64_t next_random(Generator_t *generator) {
+  // xorshift64*
+  generator->random_state ^= generator->random_state >> 12;
+  generator->random_state ^= generator->random_state << 25;
+  generator->random_state ^= generator->random_state >> 27;
+  return generator->random_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double next_uniform(Generator_t *generator) {
+  // in [0, 1), from the top 53 bits
+  return (next_random(generator) >> 11) * (1.0 / (1ULL << 53));
+}
+
+static uint64_t next_arrival_gap(Generator_t *generator, double interval) {
+  // exponential gaps make each core a Poisson source with the given mean interval
+  return (uint64_t)llround(-log(1.0 - next_uniform(generator)) * interval);
+}
+
+static void open_new_row(Generator_t *generator, CoreStream_t *core) {
+  // pick a bank by its skewed weight; targets are numbered channel first, then bank group,
+  // then bank, so the heaviest ones are spread over both channels and all bank groups
+  double u = next_uniform(generator) * generator->target_cdf[NUM_TARGETS - 1];
+  int low = 0, high = NUM_TARGETS - 1;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (generator->target_cdf[middle] > u) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  core->target.channel = low % NUM_CHANNELS;
+  core->target.bank_group = (low / NUM_CHANNELS) % NUM_BANK_GROUPS;
+  core->target.bank = low / (NUM_CHANNELS * NUM_BANK_GROUPS);
+
+  if (generator->pattern == PATTERN_STRIDE) {
+    core->target.row = core->next_row++;
+    core->target.column_high = 0;
+  } else {
+    core->target.row = next_random(generator) % NUM_ROWS;
+    core->target.column_high = next_random(generator) % LINES_PER_ROW;
+  }
+  core->address = get_address(&core->target);
+}
+
+static uint64_t parse_count(char *value, const char *name) {
+  char *end;
+  uint64_t count = strtoull(value, &end, 10);
+  if (*value == '\0' || *value == '-' || *end != '\0') {
+    fprintf(stderr, "Invalid %s: %s. Must be a non-negative integer.\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
+
+static double parse_fraction(char *value, const char *name) {
+  char *end;
+  double fraction = strtod(value, &end);
+  if (*value == '\0' || *end != '\0' || !(fraction >= 0.0 && fraction <= 1.0)) {
+    fprintf(stderr, "Invalid %s: %s. Must be between 0 and 1.\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  return fraction;
+}
+
+int main(int argc, char *argv[]) {
+  char *output_file_name = DEFAULT_OUTPUT_FILE;
+  uint64_t request_count = 0;
+  bool has_request_count = false;
+  bool is_binary = false;
+  double intervals[NUM_CORES] = {DEFAULT_INTERVAL};
+  int interval_count = 1;
+  double bank_skew = 0.0;
+  uint64_t seed = DEFAULT_SEED;
+  Generator_t *generator = calloc(1, sizeof(Generator_t));
+  int opt;
+
+  if (generator == NULL) {
+    fprintf(stderr, "%s:%d: malloc failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  generator->core_count = DEFAULT_CORES;
+  generator->operation_weights[0] = 6;
+  generator->operation_weights[1] = 3;
+  generator->operation_weights[2] = 1;
+  generator->locality = DEFAULT_LOCALITY;
+  generator->pattern = PATTERN_RANDOM;
+  generator->stride_lines = DEFAULT_STRIDE / CACHE_LINE_SIZE;
+
+  while ((opt = getopt(argc, argv, "n:o:c:r:m:l:p:S:k:x:M:bh")) != -1) {
+    switch (opt) {
+      case 'n':  // Number of requests
+        request_count = parse_count(optarg, "request count");
+        has_request_count = true;
+        break;
+      case 'o':  // Trace file
+        output_file_name = optarg;
+        break;
+      case 'c':  // Number of cores
+        generator->core_count = atoi(optarg);
+        if (generator->core_count < 1 || generator->core_count > NUM_CORES) {
+          fprintf(stderr, "Invalid core count: %s. Must be between 1 and %d.\n", optarg, NUM_CORES);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'r': {  // Comma separated mean arrival intervals, one per core
+        interval_count = 0;
+        for (char *token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")) {
+          char *end;
+          double interval = strtod(token, &end);
+          if (interval_count == NUM_CORES || *end != '\0' || !(interval >= 0.0)) {
+            fprintf(stderr, "Invalid arrival interval: %s. Must be at most %d non-negative numbers.\n", token, NUM_CORES);
+            exit(EXIT_FAILURE);
+          }
+          intervals[interval_count++] = interval;
+        }
+        if (interval_count == 0) {
+          fprintf(stderr, "Invalid arrival interval: %s.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      }
+      case 'm': {  // read:write:ifetch ratio
+        unsigned int weights[NUM_OPERATIONS];
+        char extra;
+        if (
+          sscanf(optarg, "%u:%u:%u%c", &weights[0], &weights[1], &weights[2], &extra) != 3 ||
+          (uint64_t)weights[0] + weights[1] + weights[2] == 0 ||
+          (uint64_t)weights[0] + weights[1] + weights[2] > UINT32_MAX
+        ) {
+          fprintf(stderr, "Invalid operation mix: %s. Must be read:write:ifetch, e.g. 6:3:1.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < NUM_OPERATIONS; i++) {
+          generator->operation_weights[i] = weights[i];
+        }
+        break;
+      }
+      case 'l':  // Probability of staying in the current row
+        generator->locality = parse_fraction(optarg, "locality");
+        break;
+      case 'p':  // Access pattern
+        if (strcmp(optarg, "stride") == 0) {
+          generator->pattern = PATTERN_STRIDE;
+        } else if (strcmp(optarg, "random") == 0) {
+          generator->pattern = PATTERN_RANDOM;
+        } else {
+          fprintf(stderr, "Invalid pattern: %s. Must be stride or random.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'S': {  // Stride in bytes
+        uint64_t stride = parse_count(optarg, "stride");
+        if (stride == 0 || stride % CACHE_LINE_SIZE != 0) {
+          fprintf(stderr, "Invalid stride: %s. Must be a positive multiple of %d.\n", optarg, CACHE_LINE_SIZE);
+          exit(EXIT_FAILURE);
+        }
+        generator->stride_lines = stride / CACHE_LINE_SIZE;
+        break;
+      }
+      case 'k': {  // Bank skew
+        char *end;
+        bank_skew = strtod(optarg, &end);
+        if (*end != '\0' || !(bank_skew >= 0.0)) {
+          fprintf(stderr, "Invalid bank skew: %s. Must be non-negative.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      }
+      case 'x':  // Seed
+        seed = parse_count(optarg, "seed");
+        break;
+      case 'M': {  // Address mapping the trace is encoded for
+        AddressMapping_t address_mapping;
+        if (!address_mapping_from_name(optarg, &address_mapping)) {
+          fprintf(stderr, "Invalid address mapping: %s. Must be default, xor, row or line.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        set_address_mapping(address_mapping);
+        break;
+      }
+      case 'b':  // Binary trace
+        is_binary = true;
+        break;
+      case 'h':
+      case '?':
+        usage(argv[0]);
+    }
+  }
+
+  if (!has_request_count || optind != argc) {
+    usage(argv[0]);
+  }
+
+  generator_init(generator, intervals, interval_count, bank_skew, seed);
+  TraceWriter_t *writer = trace_writer_open(output_file_name);
+
+  // the request count is known up front, so a binary trace can be streamed as well
+  if (is_binary) {
+    TraceHeader_t header = {0};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord_t);
+    header.record_count = request_count;
+    trace_writer_write(writer, &header, sizeof(header));
+  }
+
+  for (uint64_t i = 0; i < request_count; i++) {
+    TraceRecord_t record = {0};
+    generate_request(generator, &record);
+
+    if (is_binary) {
+      trace_writer_write(writer, &record, sizeof(record));
+      continue;
+    }
+
+    char *line = trace_writer_reserve(writer, MAX_LINE_LENGTH);
+    size_t length = format_decimal(line, record.time, 0);
+    line[length++] = ' ';
+    length += format_decimal(line + length, record.core, 0);
+    line[length++] = ' ';
+    length += format_decimal(line + length, record.operation, 0);
+    line[length++] = ' ';
+    length += format_hex(line + length, record.address, 9);
+    line[length++] = '\n';
+    trace_writer_commit(writer, length);
+  }
+
+  trace_writer_close(writer);
+  free(generator);
+
+  if (strcmp(output_file_name, DEFAULT_OUTPUT_FILE) != 0) {
+    printf("Generated %" PRIu64 " requests\n", request_count);
+  }
+  return 0;
+}
+
+void generator_init(Generator_t *generator, double *intervals, int interval_count, double bank_skew, uint64_t seed) {
+  // splitmix64 spreads the seed over the state, which must not be zero
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  generator->random_state = (z ^ (z >> 31)) | 1;
+
+  for (int i = 0; i < NUM_OPERATIONS; i++) {
+    generator->operation_total += generator->operation_weights[i];
+  }
+
+  // bank i (in address order) has weight 1 / (i + 1)^skew; a skew of 0 is uniform
+  double total = 0.0;
+  for (int i = 0; i < NUM_TARGETS; i++) {
+    total += 1.0 / pow(i + 1, bank_skew);
+    generator->target_cdf[i] = total;
+  }
+
+  // cores missing from the interval list repeat the last interval; each core starts
+  // its strides in its own share of the rows
+  for (int i = 0; i < generator->core_count; i++) {
+    CoreStream_t *core = &generator->cores[i];
+    core->interval = intervals[(i < interval_count) ? i : interval_count - 1];
+    core->next_time = next_arrival_gap(generator, core->interval);
+    core->next_row = (uint16_t)((uint64_t)i * NUM_ROWS / generator->core_count);
+  }
+}
+
+void generate_request(Generator_t *generator, TraceRecord_t *record) {
+  // the core with the earliest arrival goes next, so the trace is in time order
+  int next_core = 0;
+  for (int i = 1; i < generator->core_count; i++) {
+    if (generator->cores[i].next_time < generator->cores[next_core].next_time) {
+      next_core = i;
+    }
+  }
+
+  CoreStream_t *core = &generator->cores[next_core];
+  MemoryRequest_t *target = &core->target;
+
+  if (!core->is_started || next_uniform(generator) >= generator->locality) {
+    open_new_row(generator, core);
+    core->is_started = true;
+  } else if (generator->pattern == PATTERN_STRIDE) {
+    // a sequential walk steps through physical addresses, and the mapping decides where each one goes
+    core->address = (core->address + generator->stride_lines * CACHE_LINE_SIZE) % ADDRESS_SPACE;
+    memory_request_init(target, 0, 0, 0, core->address);
+  } else {
+    target->column_high = next_random(generator) % LINES_PER_ROW;
+    core->address = get_address(target);
+  }
+
+  uint64_t pick = next_random(generator) % generator->operation_total;
+  int operation = 0;
+  while (pick >= generator->operation_weights[operation]) {
+    pick -= generator->operation_weights[operation++];
+  }
+
+  record->time = core->next_time;
+  record->address = core->address;
+  record->core = next_core;
+  record->operation = operation;
+
+  core->next_time += next_arrival_gap(generator, core->interval);
+}
+
+void usage(char *program) {
+  fprintf(stderr,
+          "Usage: %s -n request_count [-o output_file] [-c cores] [-r intervals] [-m read:write:ifetch] [-l locality] "
+          "[-p stride|random] [-S stride] [-k bank_skew] [-x seed] [-M address_mapping] [-b]\n",
+          program);
+  exit(EXIT_FAILURE);
+}
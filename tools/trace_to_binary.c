@@ -0,0 +1,80 @@
+/**
+ * @file    trace_to_binary.c
+ *
+ * @brief   Converts a text trace into the binary trace format, which ./bin/main
+ *          detects and replays without parsing text
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <getopt.h>
+#include <stddef.h>
+#include "parser.h"
+#include "trace_writer.h"
+
+#define DEFAULT_INPUT_FILE "trace.txt"
+
+int main(int argc, char *argv[]) {
+  char *input_file_name = DEFAULT_INPUT_FILE;
+  char *output_file_name = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:o:h")) != -1) {
+    switch (opt) {
+      case 'i':  // Text trace
+        input_file_name = optarg;
+        break;
+      case 'o':  // Binary trace
+        output_file_name = optarg;
+        break;
+      case 'h':
+      case '?':
+        fprintf(stderr, "Usage: %s [-i input_file] -o binary_trace\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (output_file_name == NULL) {
+    fprintf(stderr, "Usage: %s [-i input_file] -o binary_trace\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  Parser_t *parser = parser_init(input_file_name);
+  TraceWriter_t *writer = trace_writer_open(output_file_name);
+
+  TraceHeader_t header = {0};
+  memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  header.version = TRACE_VERSION;
+  header.record_size = sizeof(TraceRecord_t);
+  trace_writer_write(writer, &header, sizeof(header));
+
+  // every request is due at the last possible cycle, so the parser hands them all out in order
+  MemoryRequest_t *request;
+  while ((request = parser_next_request(parser, UINT64_MAX)) != NULL) {
+    TraceRecord_t record = {
+      .time = request->time,
+      .address = get_address(request),
+      .core = request->core,
+      .operation = request->operation
+    };
+    trace_writer_write(writer, &record, sizeof(record));
+    header.record_count++;
+  }
+
+  // the record count is only known now, patch it into the header
+  trace_writer_flush(writer);
+  if (
+    fseek(writer->file, offsetof(TraceHeader_t, record_count), SEEK_SET) != 0 ||
+    fwrite(&header.record_count, sizeof(header.record_count), 1, writer->file) != 1
+  ) {
+    fprintf(stderr, "%s:%d: writing the trace header failed\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("Converted %" PRIu64 " requests\n", header.record_count);
+
+  trace_writer_close(writer);
+  parser_destroy(parser);
+  return 0;
+}